@@ -0,0 +1,136 @@
+// bench_deserialize.cc
+// Micro-benchmark for fragment payload deserialization.
+//
+// Usage: bench_deserialize [frames_per_fragment] [iterations]
+//
+// Every case decodes the same HCal payload (the example ECON-D packet repeated per frame) and
+// reports ns per frame and payload MB/s:
+//   legacy:  per-frame vector whose default value is the ~200-word example packet, resized,
+//            filled one bounds-checked word at a time and copied into the frame list
+//   owning:  the same loop with today's empty default-constructed HCalFrame
+//   generic: read_subsystem_data<HCalData>, one bounds check and one memcpy per frame into a FrameArena
+//   view:    read_frames, walking the frames in place without copying them
+//   memcpy:  one memcpy of the whole payload into a preallocated buffer, the ceiling for any copy
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "BinaryReader.hh"
+#include "HCalFrame.hh"
+#include "ExamplePackets.hh"
+
+namespace {
+
+// The frame layout before example packets moved out of the frame types
+struct LegacyHCalFrame {
+    std::vector<uint32_t> frame_data{std::begin(ExamplePackets::econd_event), std::end(ExamplePackets::econd_event)};
+};
+
+std::vector<char> make_payload(uint32_t num_frames) {
+    std::vector<char> buffer;
+    auto write = [&](const auto& val) {
+        const char* p = reinterpret_cast<const char*>(&val);
+        buffer.insert(buffer.end(), p, p + sizeof(val));
+    };
+    write(static_cast<long long>(1234567890));
+    write(num_frames);
+    for (uint32_t i = 0; i < num_frames; ++i) {
+        uint32_t num_words = static_cast<uint32_t>(std::size(ExamplePackets::econd_event));
+        write(num_words);
+        for (uint32_t word : ExamplePackets::econd_event) write(word);
+    }
+    return buffer;
+}
+
+// Word-by-word decode into owning frames, as the readers used to do
+template <typename Frame>
+size_t decode_owning(const std::vector<char>& buffer) {
+    std::vector<Frame> frames;
+    size_t offset = 0;
+    auto read = [&](auto& val) {
+        if (offset + sizeof(val) > buffer.size()) {
+            throw std::out_of_range("Buffer read out of bounds.");
+        }
+        memcpy(&val, buffer.data() + offset, sizeof(val));
+        offset += sizeof(val);
+    };
+    long long timestamp;
+    read(timestamp);
+    uint32_t num_frames;
+    read(num_frames);
+    for (uint32_t i = 0; i < num_frames; ++i) {
+        Frame frame;
+        uint32_t num_frame_words;
+        read(num_frame_words);
+        frame.frame_data.resize(num_frame_words);
+        for (uint32_t j = 0; j < num_frame_words; ++j) {
+            read(frame.frame_data[j]);
+        }
+        frames.push_back(frame);
+    }
+    return frames.size() + frames.back().frame_data.back();
+}
+
+size_t decode_generic(const std::vector<char>& buffer) {
+    HCalData data = read_subsystem_data<HCalData>(buffer);
+    FrameView last = data.frames[data.frames.size() - 1];
+    return data.frames.size() + last[last.size() - 1];
+}
+
+size_t decode_view(const std::vector<char>& buffer) {
+    size_t frames = 0;
+    uint32_t last = 0;
+    read_frames(buffer, [&](const char* words, uint32_t num_words) {
+        ++frames;
+        memcpy(&last, words + (num_words - 1) * sizeof(uint32_t), sizeof(last));
+    });
+    return frames + last;
+}
+
+size_t copy_payload(const std::vector<char>& buffer) {
+    std::vector<uint32_t> words(buffer.size() / sizeof(uint32_t) + 1);
+    memcpy(words.data(), buffer.data(), buffer.size());
+    return words[buffer.size() / sizeof(uint32_t) - 1];
+}
+
+template <typename Decode>
+double run(const std::string& name, const std::vector<char>& payload, uint32_t num_frames, size_t iterations,
+           Decode decode, double baseline_ns = 0.0) {
+    size_t sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) sink += decode(payload);
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    double ns_per_frame = ns / (static_cast<double>(iterations) * num_frames);
+    double mb_per_s = static_cast<double>(payload.size()) * iterations / ns * 1e3;
+    std::cout << std::left << std::setw(8) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << ns_per_frame << " ns/frame" << std::setw(10) << mb_per_s << " MB/s";
+    if (baseline_ns > 0.0) std::cout << std::setw(8) << baseline_ns / ns << "x";
+    std::cout << "   (checksum " << sink << ")" << std::endl;
+    return ns;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    uint32_t num_frames = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 50;
+    size_t iterations = argc > 2 ? static_cast<size_t>(std::atol(argv[2])) : 20000;
+    if (num_frames == 0) num_frames = 1;
+
+    std::vector<char> payload = make_payload(num_frames);
+    std::cout << "[bench_deserialize] " << num_frames << " frames of " << std::size(ExamplePackets::econd_event)
+              << " words, " << payload.size() << " bytes per fragment, " << iterations << " iterations" << std::endl;
+
+    double legacy = run("legacy", payload, num_frames, iterations, decode_owning<LegacyHCalFrame>);
+    run("owning", payload, num_frames, iterations, decode_owning<HCalFrame>, legacy);
+    double generic = run("generic", payload, num_frames, iterations, decode_generic, legacy);
+    run("view", payload, num_frames, iterations, decode_view, legacy);
+    double ceiling = run("memcpy", payload, num_frames, iterations, copy_payload, legacy);
+    std::cout << "[bench_deserialize] generic reader runs at " << std::setprecision(0)
+              << 100.0 * ceiling / generic << "% of memcpy throughput" << std::endl;
+    return 0;
+}
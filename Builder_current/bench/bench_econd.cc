@@ -0,0 +1,170 @@
+// bench_econd.cc
+// Micro-benchmark for ECON-D packet unpacking.
+//
+// Usage: bench_econd [iterations]
+//
+// Unpacks ECON-D packets into EcondHits and reports ns per packet, ns per hit and packet MB/s:
+//   example:   the example packet (6 links x 37 channels, all 24-bit records), once with the
+//              portable field extraction and once with the AVX2 kernel where the CPU has it
+//   crc:       the packet CRC alone with each engine, and the folded CRC's time as a share of a
+//              full unpack (each the best of 10 interleaved runs)
+//   occupancy: generated zero-suppressed packets (6 links, random record codes) with a given
+//              share of channels present, to show that cost follows the hits, not the channel count
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "EcondUnpacker.hh"
+#include "ExamplePackets.hh"
+
+namespace {
+
+// Appends bits MSB first to a word stream
+struct BitWriter {
+    std::vector<uint32_t>& words;
+    uint64_t bit = 0;
+
+    void put(uint32_t value, uint32_t num_bits) {
+        for (uint32_t i = 0; i < num_bits; ++i) {
+            if (bit % 32 == 0) words.push_back(0);
+            if ((value >> (num_bits - 1 - i)) & 1) words.back() |= 1u << (31 - bit % 32);
+            ++bit;
+        }
+    }
+};
+
+// A zero-suppressed packet where each channel of each link is present with probability occupancy
+std::vector<uint32_t> make_packet(double occupancy, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::bernoulli_distribution present(occupancy);
+    std::uniform_int_distribution<uint32_t> code(0, 15);
+    std::uniform_int_distribution<uint32_t> bits(0, 0xFFFFFFFF);
+
+    std::vector<uint32_t> packet(econd::kHeaderWords, 0);
+    for (int link = 0; link < 6; ++link) {
+        uint64_t channel_map = 0;
+        for (size_t channel = 0; channel < econd::kMaxChannels; ++channel) {
+            if (present(rng)) channel_map |= 1ull << channel;
+        }
+        packet.push_back(0xE0000000u | static_cast<uint32_t>(channel_map >> 32));
+        packet.push_back(static_cast<uint32_t>(channel_map));
+        std::vector<uint32_t> body;
+        BitWriter writer{body};
+        for (uint64_t map = channel_map; map != 0; map &= map - 1) {
+            uint32_t c = code(rng);
+            uint32_t record_bits = econd::kRecordBits[econd::record_class(c << 28, false)];
+            writer.put(c, 4);
+            writer.put(bits(rng) >> (36 - record_bits), record_bits - 4);
+        }
+        packet.insert(packet.end(), body.begin(), body.end());
+    }
+    packet.push_back(econd::crc32(packet.data() + econd::kHeaderWords, packet.size() - econd::kHeaderWords));
+    packet[0] = (0x1E6u << 23) | static_cast<uint32_t>(packet.size() - econd::kHeaderWords) << econd::kPayloadLengthShift;
+    return packet;
+}
+
+// Total ns for iterations unpacks of packet; hits and sink keep the last result and a checksum
+double time_unpack(const std::vector<uint32_t>& packet, bool simd, size_t iterations, bool check_crc,
+                   EcondHits& hits, size_t& sink) {
+    EcondValidation validation;
+    validation.check_crc = check_crc;
+    EcondUnpacker unpacker(validation);
+    unpacker.set_simd(simd);
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        hits.clear();
+        unpacker.unpack(packet.data(), packet.size(), hits);
+        sink += hits.size() + (hits.size() != 0 ? hits.adc[hits.size() - 1] : 0);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Total ns for iterations CRCs of the packet payload
+double time_crc(const std::vector<uint32_t>& packet, bool accelerated, size_t iterations, uint32_t& crc) {
+    const uint32_t* payload = packet.data() + econd::kHeaderWords;
+    size_t payload_words = packet.size() - econd::kHeaderWords - 1;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < iterations; ++i) {
+        crc += econd::crc32(payload, payload_words, accelerated);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+double run(const std::string& name, const std::vector<uint32_t>& packet, bool simd, size_t iterations,
+           double baseline_ns = 0.0, bool check_crc = true) {
+    EcondHits hits;
+    size_t sink = 0;
+    double ns = time_unpack(packet, simd, iterations, check_crc, hits, sink);
+
+    double ns_per_packet = ns / static_cast<double>(iterations);
+    double mb_per_s = static_cast<double>(packet.size() * sizeof(uint32_t)) * iterations / ns * 1e3;
+    std::cout << std::left << std::setw(10) << name << std::right << std::fixed << std::setprecision(1)
+              << std::setw(5) << hits.size() << " hits" << std::setw(10) << ns_per_packet << " ns/packet"
+              << std::setw(8) << (hits.size() != 0 ? ns_per_packet / hits.size() : 0.0) << " ns/hit"
+              << std::setw(10) << mb_per_s << " MB/s";
+    if (baseline_ns > 0.0) std::cout << std::setw(8) << baseline_ns / ns << "x";
+    std::cout << "   (checksum " << sink << ")" << std::endl;
+    return ns;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    size_t iterations = argc > 1 ? static_cast<size_t>(std::atol(argv[1])) : 200000;
+    bool simd = EcondUnpacker().simd();
+
+    std::vector<uint32_t> example(std::begin(ExamplePackets::econd_event), std::end(ExamplePackets::econd_event));
+    std::cout << "[bench_econd] " << example.size() << "-word example packet, " << iterations << " iterations" << std::endl;
+    double scalar = run("scalar", example, false, iterations);
+    if (simd) {
+        run("avx2", example, true, iterations, scalar);
+    } else {
+        std::cout << "[bench_econd] no AVX2 on this CPU, vector kernel skipped" << std::endl;
+    }
+
+    // The packet CRC on its own
+    for (bool accelerated : {false, true}) {
+        uint32_t crc = 0;
+        double ns = time_crc(example, accelerated, iterations, crc);
+        std::cout << std::left << std::setw(10) << (accelerated ? "crc fold" : "crc table") << std::right
+                  << std::setw(20) << ns / iterations << " ns/packet   (checksum " << crc << ")" << std::endl;
+    }
+
+    /*
+    ...and as a share of a full unpack. The difference between unpacks with and without the check
+    is smaller than the run-to-run noise, so the share is the CRC time over the unpack time
+    instead, each the best of several short runs taken in turn so drift hits both alike.
+    */
+    const size_t rounds = 10;
+    size_t round_iterations = std::max<size_t>(iterations / rounds, 1);
+    double best_crc = 0.0;
+    double best_unpack = 0.0;
+    EcondHits hits;
+    size_t sink = 0;
+    uint32_t crc = 0;
+    for (size_t round = 0; round < rounds; ++round) {
+        double crc_ns = time_crc(example, true, round_iterations, crc);
+        double unpack_ns = time_unpack(example, simd, round_iterations, true, hits, sink);
+        if (round == 0 || crc_ns < best_crc) best_crc = crc_ns;
+        if (round == 0 || unpack_ns < best_unpack) best_unpack = unpack_ns;
+    }
+    std::cout << "[bench_econd] CRC check is " << std::setprecision(1) << 100.0 * best_crc / best_unpack
+              << "% of unpack time (best of " << rounds << ": " << best_crc / round_iterations << " of "
+              << best_unpack / round_iterations << " ns/packet, checksums " << crc << ", " << sink << ")" << std::endl;
+
+    std::cout << "[bench_econd] generated packets by channel occupancy, " << (simd ? "avx2" : "scalar") << " kernel" << std::endl;
+    for (double occupancy : {1.0, 0.5, 0.2, 0.05}) {
+        std::ostringstream name;
+        name << static_cast<int>(occupancy * 100) << "%";
+        run(name.str(), make_packet(occupancy, 42), simd, iterations);
+    }
+    return 0;
+}
@@ -0,0 +1,96 @@
+// bench_merger.cc
+// Micro-benchmark for EventMerger throughput.
+//
+// Usage: bench_merger [events] [max_threads]
+//
+// Every event arrives as three single-subsystem parts (Tracker, HCal, ECal), so each part goes
+// through the merger's table: the first is stored, the second merged, the third completes the
+// event and sends it to the output queue, which a consumer thread drains. Producer thread t sends
+// the parts of events t, t + threads, ... in order. Reports merged parts per second for 1 shard
+// (every merge behind one lock) and 16 shards, with 1, 2, 4 ... max_threads producers.
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "EventMerger.hh"
+
+namespace {
+
+const uint32_t kFrame[16] = {};
+
+PhysicsEventData make_part(long long id, uint64_t subsystem) {
+    PhysicsEventData part;
+    part.event_id = id;
+    part.timestamp = id * 1000;
+    part.systems_readout.push_back(subsystem);
+    FrameArena& frames = subsystem == 0 ? part.tracker_info.frames
+                       : subsystem == 1 ? part.hcal_info.frames
+                       : part.ecal_info.frames;
+    frames.append(reinterpret_cast<const char*>(kFrame), 16);
+    return part;
+}
+
+double run(const CompletenessModel& model, size_t shards, size_t threads, size_t events) {
+    MergedEventQueue output(1024);
+    MergerConfig config;
+    config.shards = shards;
+    config.expected_in_flight = 4096;
+    EventMerger merger(model, output, config);
+    size_t drained = 0;
+    std::thread consumer([&]() {
+        MergedEvent merged;
+        while (output.pop(merged)) ++drained;
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (size_t t = 0; t < threads; ++t) {
+        producers.emplace_back([&, t]() {
+            for (size_t id = t; id < events; id += threads) {
+                for (uint64_t subsystem = 0; subsystem < 3; ++subsystem) {
+                    merger.merge_event(make_part(static_cast<long long>(id), subsystem));
+                }
+            }
+        });
+    }
+    for (auto& producer : producers) producer.join();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    output.close();
+    consumer.join();
+    if (drained != events || merger.in_flight() != 0) {
+        std::cerr << "merged " << drained << " of " << events << " events" << std::endl;
+        std::exit(1);
+    }
+    return events * 3 / seconds;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t events = argc > 1 ? std::stoull(argv[1]) : 200000;
+    size_t max_threads = argc > 2 ? std::stoull(argv[2]) : 4;
+    CompletenessModel model = CompletenessModel::default_model();
+
+    // The merger logs every part; keep that out of the timings
+    std::streambuf* console = std::cout.rdbuf(nullptr);
+    std::vector<std::vector<double>> rates;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        rates.push_back({run(model, 1, threads, events), run(model, 16, threads, events)});
+    }
+    std::cout.rdbuf(console);
+
+    std::cout << events << " events, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    std::cout << std::setw(8) << "threads" << std::setw(16) << "1 shard" << std::setw(16) << "16 shards" << "  (parts/s)" << std::endl;
+    size_t threads = 1;
+    for (const auto& row : rates) {
+        std::cout << std::setw(8) << threads << std::fixed << std::setprecision(0)
+                  << std::setw(16) << row[0] << std::setw(16) << row[1] << std::endl;
+        threads *= 2;
+    }
+    return 0;
+}
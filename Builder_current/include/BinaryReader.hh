@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <iterator>
 #include <cstring>
+#include <stdexcept>
+#include <type_traits>
 
 #include "TrkData.hh"
 #include "HCalData.hh"
@@ -22,27 +24,42 @@ public:
     // Function to read a single value
     template <typename T>
     void read(T& value) {
-        if (m_pos + sizeof(T) > m_buffer.size()) {
-            throw std::runtime_error("Buffer underrun during deserialization");
-        }
-        memcpy(&value, m_buffer.data() + m_pos, sizeof(T));
-        m_pos += sizeof(T);
+        memcpy(&value, skip(sizeof(T)), sizeof(T));
     }
 
     // Overload for deserializing a vector of structs
     /*
-    This overloaded template function handles the deserialization of a vector of complex types (T).
-    It first resizes the vector to the count specified in the binary payload. Then,
-    it iterates count times, calling the read(T& value) function to read each individual element into the vector.
+    This overloaded template function handles the deserialization of a vector of count elements of type T.
+    The whole block is bounds-checked once and, for trivially copyable T, copied with a single memcpy;
+    anything else falls back to reading element by element.
     */
     template <typename T>
     void read(std::vector<T>& vec, size_t count) {
-        vec.resize(count);
-        for (size_t i = 0; i < count; ++i) {
-            read(vec[i]);
+        if constexpr (std::is_trivially_copyable<T>::value) {
+            if (count > remaining() / sizeof(T)) {
+                throw std::out_of_range("Buffer read out of bounds.");
+            }
+            vec.resize(count);
+            if (count != 0) memcpy(vec.data(), skip(count * sizeof(T)), count * sizeof(T));
+        } else {
+            vec.resize(count);
+            for (size_t i = 0; i < count; ++i) {
+                read(vec[i]);
+            }
         }
     }
 
+    // Returns the next bytes in place and steps over them, after one bounds check
+    const char* skip(size_t bytes) {
+        if (bytes > remaining()) {
+            throw std::out_of_range("Buffer read out of bounds.");
+        }
+        const char* at = m_buffer.data() + m_pos;
+        m_pos += bytes;
+        return at;
+    }
+
+    size_t remaining() const { return m_buffer.size() - m_pos; }
     size_t get_position() const { return m_pos; }
     size_t get_size() const { return m_buffer.size(); }
 
@@ -51,92 +68,75 @@ private:
     size_t m_pos;
 };
 
-// Specific readr for TrkData
-TrkData read_tracker_data(const std::vector<char>& buffer) {
-    TrkData data;
-    size_t offset = 0;
-    auto read = [&](auto& val) {
-        if (offset + sizeof(val) > buffer.size()) {
-            throw std::out_of_range("Buffer read out of bounds.");
-        }
-        memcpy(&val, buffer.data() + offset, sizeof(val));
-        offset += sizeof(val);
-    };
+// Payload layout: timestamp, frame count, then per frame a word count and the words
+/*
+Exact number of frames and frame words in a payload, found by walking the frame headers without
+touching the words, so a container can be sized once before appending. Returns the payload
+timestamp; throws like the readers below on a malformed payload.
+*/
+long long payload_extent(const std::vector<char>& buffer, size_t& frames, size_t& words) {
+    BinaryReader reader(buffer);
 
-    read(data.timestamp);
+    long long timestamp;
+    reader.read(timestamp);
 
     uint32_t num_frames;
-    read(num_frames);
+    reader.read(num_frames);
 
+    words = 0;
     for (uint32_t i = 0; i < num_frames; ++i) {
-        TrkFrame frame;
         uint32_t num_frame_words;
-        read(num_frame_words);
-        frame.frame_data.resize(num_frame_words);
-        for (uint32_t j = 0; j < num_frame_words; ++j) {
-            read(frame.frame_data[j]);
-        }
-        data.frames.push_back(frame);
+        reader.read(num_frame_words);
+        reader.skip(static_cast<size_t>(num_frame_words) * sizeof(uint32_t));
+        words += num_frame_words;
     }
-    return data;
+    frames = num_frames;
+    return timestamp;
 }
 
+/*
+Walks a subsystem payload, calling on_frame(const char* words, uint32_t num_words) for every frame
+with the frame's word block in place (4-byte aligned relative to the payload, so read it with
+memcpy). Each frame's word count is checked against the remaining length once; the words
+themselves are never touched here. Returns the payload timestamp.
+*/
+template <typename FrameFn>
+long long read_frames(const std::vector<char>& buffer, FrameFn&& on_frame) {
+    BinaryReader reader(buffer);
 
-HCalData read_hcal_data(const std::vector<char>& buffer) {
-    HCalData data;
-    size_t offset = 0;
-    auto read = [&](auto& val) {
-        if (offset + sizeof(val) > buffer.size()) {
-            throw std::out_of_range("Buffer read out of bounds.");
-        }
-        memcpy(&val, buffer.data() + offset, sizeof(val));
-        offset += sizeof(val);
-    };
-
-    read(data.timestamp);
+    long long timestamp;
+    reader.read(timestamp);
 
     uint32_t num_frames;
-    read(num_frames);
+    reader.read(num_frames);
 
     for (uint32_t i = 0; i < num_frames; ++i) {
-        HCalFrame frame;
         uint32_t num_frame_words;
-        read(num_frame_words);
-        frame.frame_data.resize(num_frame_words);
-        for (uint32_t j = 0; j < num_frame_words; ++j) {
-            read(frame.frame_data[j]);
-        }
-        data.frames.push_back(frame);
+        reader.read(num_frame_words);
+        const char* words = reader.skip(static_cast<size_t>(num_frame_words) * sizeof(uint32_t));
+        on_frame(words, num_frame_words);
     }
-    return data;
+    return timestamp;
 }
 
+/*
+Appends the payload's frames (one memcpy per frame) to a FrameArena, or to a FrameArena::Region
+when several payloads fill one arena in parallel, and returns the payload timestamp.
+*/
+template <typename Sink>
+long long read_subsystem_data(const std::vector<char>& buffer, Sink& frames) {
+    return read_frames(buffer, [&frames](const char* words, uint32_t num_words) {
+        frames.append(words, num_words);
+    });
+}
 
-ECalData read_ecal_data(const std::vector<char>& buffer) {
-    ECalData data;
-    size_t offset = 0;
-    auto read = [&](auto& val) {
-        if (offset + sizeof(val) > buffer.size()) {
-            throw std::out_of_range("Buffer read out of bounds.");
-        }
-        memcpy(&val, buffer.data() + offset, sizeof(val));
-        offset += sizeof(val);
-    };
-
-    read(data.timestamp);
-
-    uint32_t num_frames;
-    read(num_frames);
-
-    for (uint32_t i = 0; i < num_frames; ++i) {
-        ECalFrame frame;
-        uint32_t num_frame_words;
-        read(num_frame_words);
-        frame.frame_data.resize(num_frame_words);
-        for (uint32_t j = 0; j < num_frame_words; ++j) {
-            read(frame.frame_data[j]);
-        }
-        data.frames.push_back(frame);
-    }
+// The subsystem data of a single payload
+template <typename Data>
+Data read_subsystem_data(const std::vector<char>& buffer) {
+    Data data;
+    size_t frames, words;
+    payload_extent(buffer, frames, words);
+    data.frames.reserve(frames, words);
+    data.timestamp = read_subsystem_data(buffer, data.frames);
     return data;
 }
@@ -0,0 +1,101 @@
+// BoundedQueue.hh
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+#pragma once
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstddef>
+#include <utility>
+
+/**
+ * Blocking bounded FIFO between two pipeline stages.
+ *
+ * push() waits while the queue holds capacity items, so a slow consumer holds the producer back
+ * instead of letting finished work pile up in memory. pop() waits for an item. After close()
+ * pushes are refused and pop() returns what is left, then false.
+ */
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity = 256) : m_capacity(capacity == 0 ? 1 : capacity) {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Returns false, leaving item untouched, if the queue was closed
+    bool push(T&& item) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_not_full.wait(lock, [this] { return m_closed || m_items.size() < m_capacity; });
+        if (m_closed) return false;
+        m_items.push_back(std::move(item));
+        if (m_items.size() > m_high_water) m_high_water = m_items.size();
+        lock.unlock();
+        m_not_empty.notify_one();
+        return true;
+    }
+
+    // Returns false once the queue is closed and empty
+    bool pop(T& out) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_not_empty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+        if (m_items.empty()) return false;
+        out = std::move(m_items.front());
+        m_items.pop_front();
+        lock.unlock();
+        m_not_full.notify_one();
+        return true;
+    }
+
+    // Like pop(), but gives up after timeout; finished() tells a timeout from the end of the queue
+    template <typename Rep, typename Period>
+    bool pop_for(T& out, std::chrono::duration<Rep, Period> timeout) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_not_empty.wait_for(lock, timeout, [this] { return m_closed || !m_items.empty(); })) return false;
+        if (m_items.empty()) return false;
+        out = std::move(m_items.front());
+        m_items.pop_front();
+        lock.unlock();
+        m_not_full.notify_one();
+        return true;
+    }
+
+    // Closed and empty: nothing will ever be popped again
+    bool finished() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_closed && m_items.empty();
+    }
+
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_not_empty.notify_all();
+        m_not_full.notify_all();
+    }
+
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_items.size();
+    }
+
+    size_t capacity() const { return m_capacity; }
+
+    // Largest number of items ever queued at once
+    size_t high_water() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_high_water;
+    }
+
+private:
+    const size_t m_capacity;
+    std::deque<T> m_items;
+    size_t m_high_water = 0;
+    bool m_closed = false;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_not_empty;
+    std::condition_variable m_not_full;
+};
+#endif
@@ -0,0 +1,105 @@
+// ByteOrder.hh
+#ifndef BYTEORDER_H
+#define BYTEORDER_H
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BYTE_ORDER_X86 1
+#endif
+
+/*
+Conversion of big-endian data (the ROR headers written by Rogue) to native byte order. Single
+values go through from_big_endian(); whole spans of 32-bit words go through words_from_big_endian(),
+which swaps 32 bytes per shuffle with AVX2, 16 with SSSE3 (chosen at run time), and falls back to
+a plain loop. On a big-endian host all of these are copies.
+*/
+namespace byte_order {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    inline uint32_t from_big_endian(uint32_t value) { return value; }
+    inline uint64_t from_big_endian(uint64_t value) { return value; }
+    constexpr bool kNativeBigEndian = true;
+#else
+    inline uint32_t from_big_endian(uint32_t value) { return __builtin_bswap32(value); }
+    inline uint64_t from_big_endian(uint64_t value) { return __builtin_bswap64(value); }
+    constexpr bool kNativeBigEndian = false;
+#endif
+
+    inline void swap_words_scalar(const char* src, uint32_t* dst, size_t num_words) {
+        for (size_t i = 0; i < num_words; ++i) {
+            uint32_t word;
+            std::memcpy(&word, src + i * sizeof(uint32_t), sizeof(word));
+            dst[i] = __builtin_bswap32(word);
+        }
+    }
+
+#ifdef BYTE_ORDER_X86
+    // Both return the number of words handled; the caller finishes the rest
+    __attribute__((target("avx2")))
+    inline size_t swap_words_avx2(const char* src, uint32_t* dst, size_t num_words) {
+        const __m256i reverse = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                                 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        size_t i = 0;
+        for (; i + 8 <= num_words; i += 8) {
+            __m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * sizeof(uint32_t)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_shuffle_epi8(words, reverse));
+        }
+        return i;
+    }
+
+    __attribute__((target("ssse3")))
+    inline size_t swap_words_ssse3(const char* src, uint32_t* dst, size_t num_words) {
+        const __m128i reverse = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        size_t i = 0;
+        for (; i + 4 <= num_words; i += 4) {
+            __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * sizeof(uint32_t)));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_shuffle_epi8(words, reverse));
+        }
+        return i;
+    }
+
+    enum class SwapKernel { Scalar, Ssse3, Avx2 };
+
+    inline SwapKernel best_swap_kernel() {
+        static const SwapKernel kernel = __builtin_cpu_supports("avx2") ? SwapKernel::Avx2
+                                       : __builtin_cpu_supports("ssse3") ? SwapKernel::Ssse3
+                                       : SwapKernel::Scalar;
+        return kernel;
+    }
+#endif
+
+    /*
+    Converts num_words big-endian words at src (any alignment) into native-order words at dst.
+    src and dst may be the same buffer; otherwise they must not overlap. accelerated = false forces
+    the plain loop, for comparison.
+    */
+    inline void words_from_big_endian(const void* src, uint32_t* dst, size_t num_words, bool accelerated = true) {
+        const char* bytes = static_cast<const char*>(src);
+        if (kNativeBigEndian) {
+            if (bytes != reinterpret_cast<const char*>(dst)) std::memmove(dst, bytes, num_words * sizeof(uint32_t));
+            return;
+        }
+        size_t done = 0;
+#ifdef BYTE_ORDER_X86
+        if (accelerated) {
+            switch (best_swap_kernel()) {
+                case SwapKernel::Avx2: done = swap_words_avx2(bytes, dst, num_words); break;
+                case SwapKernel::Ssse3: done = swap_words_ssse3(bytes, dst, num_words); break;
+                case SwapKernel::Scalar: break;
+            }
+        }
+#else
+        (void)accelerated;
+#endif
+        swap_words_scalar(bytes + done * sizeof(uint32_t), dst + done, num_words - done);
+    }
+
+    // In place
+    inline void words_from_big_endian(uint32_t* words, size_t num_words, bool accelerated = true) {
+        words_from_big_endian(words, words, num_words, accelerated);
+    }
+}
+#endif
@@ -0,0 +1,128 @@
+// ClockCalibration.hh
+#ifndef CLOCKCALIBRATION_H
+#define CLOCKCALIBRATION_H
+#pragma once
+#include <map>
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <cstddef>
+#include "Fragment.hh"
+
+/*
+reference_subsystem: the clock everything else is aligned to; its offset is zero by definition.
+per_link:            calibrate each (subsystem, link) pair separately rather than whole subsystems.
+forgetting:          exponential weight per observation, so the fit follows slow changes.
+min_samples:         observations a clock needs before its correction is applied.
+*/
+struct ClockCalibrationConfig {
+    uint64_t reference_subsystem = 0;
+    bool per_link = true;
+    double forgetting = 0.999;
+    size_t min_samples = 32;
+};
+
+/**
+ * Learns each subsystem's (or link's) constant offset and linear drift relative to the reference
+ * subsystem from matched events, and removes them from fragment timestamps at ingest.
+ *
+ * For every complete event the residual ts - ts_ref is fitted as offset + drift * t with an
+ * exponentially weighted least-squares fit, t being seconds since the first observation. Learning
+ * sees already-corrected timestamps, so correct() records on each fragment the correction it
+ * applied (DataFragment::clock_correction_ns) and the raw value is rebuilt from that. The model
+ * may have moved on by the time the event completes, or not have been applied at all while the
+ * clock was below min_samples, so re-predicting the correction there would feed it its own error.
+ */
+class ClockCalibration {
+public:
+    explicit ClockCalibration(const ClockCalibrationConfig& config) : m_config(config) {}
+
+    // Shifts the fragment's timestamp onto the reference clock and records the shift
+    void correct(DataFragment& fragment) const {
+        FragmentHeader& header = fragment.header;
+        auto it = m_clocks.find(key_of(header.subsystem_id, header.contributor_id));
+        if (it == m_clocks.end() || it->second.samples < m_config.min_samples) return;
+        long long ts = static_cast<long long>(header.timestamp);
+        long long correction = it->second.predict(seconds_since_origin(ts));
+        header.timestamp = static_cast<uint64_t>(ts - correction);
+        fragment.clock_correction_ns += correction;
+    }
+
+    // Learns from the fragments [first, end) of one complete event
+    void observe(const std::vector<DataFragment>& fragments, size_t first) {
+        double ref_sum = 0.0;
+        size_t ref_count = 0;
+        for (size_t i = first; i < fragments.size(); ++i) {
+            if (fragments[i].header.subsystem_id == m_config.reference_subsystem) {
+                ref_sum += static_cast<double>(raw_timestamp(fragments[i]));
+                ++ref_count;
+            }
+        }
+        if (ref_count == 0) return; // nothing to align against
+        double ref = ref_sum / ref_count;
+        if (!m_has_origin) {
+            m_origin = static_cast<long long>(ref);
+            m_has_origin = true;
+        }
+        double t = seconds_since_origin(static_cast<long long>(ref));
+
+        for (size_t i = first; i < fragments.size(); ++i) {
+            const FragmentHeader& header = fragments[i].header;
+            if (header.subsystem_id == m_config.reference_subsystem) continue;
+            Clock& clock = m_clocks[key_of(header.subsystem_id, header.contributor_id)];
+            clock.add(t, static_cast<double>(raw_timestamp(fragments[i])) - ref, m_config.forgetting);
+        }
+    }
+
+    void print() const {
+        for (const auto& pair : m_clocks) {
+            std::cout << "[ClockCalibration] subsystem " << (pair.first >> 8);
+            if (m_config.per_link) std::cout << " link " << (pair.first & 0xFF);
+            std::cout << ": offset " << pair.second.offset << " ns, drift " << pair.second.drift
+                      << " ns/s (" << pair.second.samples << " samples)" << std::endl;
+        }
+    }
+
+private:
+    // Weighted least-squares state for residual = offset + drift * t
+    struct Clock {
+        double sw = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+        double offset = 0.0;
+        double drift = 0.0;
+        size_t samples = 0;
+
+        void add(double x, double y, double lambda) {
+            sw = lambda * sw + 1.0;
+            sx = lambda * sx + x;
+            sy = lambda * sy + y;
+            sxx = lambda * sxx + x * x;
+            sxy = lambda * sxy + x * y;
+            ++samples;
+            double denom = sw * sxx - sx * sx;
+            // Fit the drift only once the observations span some time; until then it is just an offset
+            drift = denom > 1e-9 * sw * sw ? (sw * sxy - sx * sy) / denom : 0.0;
+            offset = (sy - drift * sx) / sw;
+        }
+
+        long long predict(double x) const { return static_cast<long long>(offset + drift * x); }
+    };
+
+    // The timestamp as it arrived, before any correction at ingest
+    static long long raw_timestamp(const DataFragment& fragment) {
+        return static_cast<long long>(fragment.header.timestamp) + fragment.clock_correction_ns;
+    }
+
+    uint32_t key_of(uint64_t subsystem, uint64_t link) const {
+        return static_cast<uint32_t>((subsystem << 8) | (m_config.per_link ? (link & 0xFF) : 0));
+    }
+
+    double seconds_since_origin(long long ts) const {
+        return m_has_origin ? static_cast<double>(ts - m_origin) * 1e-9 : 0.0;
+    }
+
+    ClockCalibrationConfig m_config;
+    std::map<uint32_t, Clock> m_clocks;
+    long long m_origin = 0;
+    bool m_has_origin = false;
+};
+#endif
@@ -1,17 +1,41 @@
 // DataAggregator.hh
 #ifndef DATAAGGREGATOR_H
 #define DATAAGGREGATOR_H
+#include <vector>
+#include "EventMerger.hh"
+#include "MergerFarm.hh"
 
+/*
+Hands assembled (possibly partial) events to the merging stage: either an EventMerger in this
+process, or a farm of merger processes, one link each, picked by event_id % number of links.
+*/
 class DataAggregator {
 public:
-    DataAggregator(EventMerger& merger_ref) : m_merger(merger_ref) {}
+    DataAggregator(EventMerger& merger_ref) : m_merger(&merger_ref) {}
+
+    explicit DataAggregator(std::vector<merger_farm::MergerLink> links)
+        : m_links(std::move(links)) {}
 
     // CHANGE: Accept an rvalue reference (&&) to allow std::move to bind
     void aggregate(PhysicsEventData&& event) {
-        // In a real system, this might send data across processes/network to the merger farm
-        m_merger.merge_event(std::move(event));
+        if (m_merger != nullptr) {
+            m_merger->merge_event(std::move(event));
+            return;
+        }
+        // Every part of an event goes to the same node, so the nodes never need to talk to each other
+        size_t node = static_cast<uint64_t>(event.event_id) % m_links.size();
+        merger_farm::encode_message(event, m_message);
+        m_links[node].send(m_message);
+    }
+
+    // Closes the links to the farm, which lets the nodes finish once every builder is done
+    void close() {
+        for (auto& link : m_links) link.close();
     }
+
 private:
-    EventMerger& m_merger;
+    EventMerger* m_merger = nullptr;
+    std::vector<merger_farm::MergerLink> m_links;
+    std::vector<char> m_message; // reused for every event sent to the farm
 };
 #endif
@@ -2,10 +2,15 @@
 #include <fstream>
 #include <vector>
 #include <cstdint>
+#include <charconv>
+#include <cstring>
+#include <array>
+#include "ByteOrder.hh"
+#include "RorContributors.hh"
 
-// Utility for Big-Endian to Little-Endian conversion
-#define SWAP32(x) (((x) >> 24) | (((x) & 0x00FF0000) >> 8) | (((x) & 0x0000FF00) << 8) | ((x) << 24))
-#define SWAP64(x) (((uint64_t)SWAP32((uint32_t)(x)) << 32) | (uint64_t)SWAP32((uint32_t)((x) >> 32)))
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 class Decoder {
 public:
@@ -31,28 +36,27 @@ public:
                 continue;
             }
 
-            // Word 1 & 2: Rogue Internal Headers (Skip 8 bytes)
-            binFile.seekg(8, std::ios::cur);
+            // Words 1-6 are big-endian; read them in one go and convert them together
+            uint32_t header[6];
+            if (!binFile.read(reinterpret_cast<char*>(header), sizeof(header))) break;
+            byte_order::words_from_big_endian(header, 6);
+
+            // Word 1 & 2: Rogue Internal Headers (unused)
 
             // Word 3: Subsystem ID
-            uint32_t rawID;
-            binFile.read(reinterpret_cast<char*>(&rawID), 4);
-            uint32_t sysID = SWAP32(rawID);
+            uint32_t sysID = header[2];
             int contribID = (sysID >> 16) & 0xFF;
 
             // Word 4 & 5: 64-bit PulseID (Timestamp)
-            uint64_t rawTs;
-            binFile.read(reinterpret_cast<char*>(&rawTs), 8);
-            uint64_t timestamp = SWAP64(rawTs);
+            uint64_t timestamp = (static_cast<uint64_t>(header[3]) << 32) | header[4];
 
             // Word 6: 32-bit Event ID
-            uint32_t rawEv;
-            binFile.read(reinterpret_cast<char*>(&rawEv), 4);
-            uint32_t eventId = SWAP32(rawEv);
+            uint32_t eventId = header[5];
 
-            // Route based on Contributor ID (20=HCal, 30=ECal)
-            if (contribID == 20 || contribID == 30) {
-                processPayload(binFile, outputFile, timestamp, eventId, contribID, sysID, frameSize);
+            // Route based on Contributor ID, through the decoders registered in RorContributors.hh
+            PayloadDecoder decode = payloadDecoders()[contribID];
+            if (decode != nullptr) {
+                (this->*decode)(binFile, outputFile, timestamp, eventId, sysID, frameSize);
             } else {
                 // Skip non-data metadata frames
                 binFile.seekg(frameSize - 24, std::ios::cur);
@@ -61,6 +65,15 @@ public:
     }
 
 private:
+    using PayloadDecoder = void (Decoder::*)(std::ifstream&, std::ofstream&, uint64_t, uint32_t, uint32_t, uint32_t);
+
+    // Contributor ID -> processPayload specialised for that contributor, or null for frames to skip
+    static const std::array<PayloadDecoder, DecodedContributors::kTableSize>& payloadDecoders() {
+        static constexpr auto table = DecodedContributors::table<PayloadDecoder>(
+            [](auto tag) { return &Decoder::processPayload<typename decltype(tag)::type>; });
+        return table;
+    }
+
     bool syncToBinary(std::ifstream& binFile) {
         uint32_t syncWord;
         while (binFile.read(reinterpret_cast<char*>(&syncWord), 4)) {
@@ -74,23 +87,106 @@ private:
         return false;
     }
 
+    template <typename Contributor>
     void processPayload(std::ifstream& binFile, std::ofstream& outputFile,
-                        uint64_t ts, uint32_t ev, int contribID, uint32_t sysID, uint32_t frameSize) {
+                        uint64_t ts, uint32_t ev, uint32_t sysID, uint32_t frameSize) {
+        static_assert(Contributor::layout == PayloadLayout::AdcPairs16, "no decode loop for this payload layout");
+        static_assert(Contributor::sample_bytes == sizeof(uint32_t), "AdcPairs16 samples are 32 bits");
+        constexpr int contribID = Contributor::id;
+        constexpr int sampleBytes = static_cast<int>(Contributor::sample_bytes);
 
         // Calculate remaining bytes in the frame to read
         int remainingBytes = frameSize - 24;
-        int numSamples = remainingBytes / 4; // Assuming 32-bit ADC samples
+        int numSamples = remainingBytes / sampleBytes;
+
+        // One read for the whole payload; a short read at the end of the file keeps the whole samples it got
+        m_payload.resize(numSamples);
+        binFile.read(reinterpret_cast<char*>(m_payload.data()), static_cast<std::streamsize>(numSamples) * sampleBytes);
+        numSamples = static_cast<int>(binFile.gcount() / sampleBytes);
 
+        // Each sample is adc_tm1 in its first two bytes and adc in the next two
+        m_adc_tm1.resize(numSamples);
+        m_adc.resize(numSamples);
+        splitSamples(m_payload.data(), numSamples, m_adc_tm1.data(), m_adc.data());
+
+        // Output matching the test.csv format
+        // timestamp,orbit,bx,event,subsystem,raw_hex_ID,contributorID,channel,adc_tm1,adc
+        // The columns before channel are the same for the whole frame, so they are formatted once
+        char prefix[96];
+        char* p = prefix;
+        p = appendNumber(p, ts);
+        p = appendText(p, ",0,0,");
+        p = appendNumber(p, ev);
+        *p++ = ',';
+        p = appendNumber(p, contribID);
+        *p++ = ',';
+        p = appendNumber(p, sysID, 16);
+        *p++ = ',';
+        p = appendNumber(p, contribID);
+        *p++ = ',';
+        size_t prefixLength = p - prefix;
+
+        // Longest row: prefix, three numbers of at most 10 digits, separators and ",-1,0\n"
+        m_text.resize(static_cast<size_t>(numSamples) * (prefixLength + 40));
+        char* out = m_text.data();
         for (int i = 0; i < numSamples; ++i) {
-            uint16_t adc, adc_tm1;
-            binFile.read(reinterpret_cast<char*>(&adc_tm1), 2);
-            binFile.read(reinterpret_cast<char*>(&adc), 2);
-
-            // Output matching the test.csv format
-            // timestamp,orbit,bx,event,subsystem,raw_hex_ID,contributorID,channel,adc_tm1,adc
-            outputFile << ts << ",0,0," << ev << "," << contribID << ","
-                       << std::hex << sysID << std::dec << "," << contribID << ","
-                       << i << "," << adc_tm1 << "," << adc << ",-1,0\n";
+            std::memcpy(out, prefix, prefixLength);
+            out += prefixLength;
+            out = appendNumber(out, i);
+            *out++ = ',';
+            out = appendNumber(out, m_adc_tm1[i]);
+            *out++ = ',';
+            out = appendNumber(out, m_adc[i]);
+            out = appendText(out, ",-1,0\n");
+        }
+        outputFile.write(m_text.data(), out - m_text.data());
+    }
+
+    // Writes value in the given base; out must have room for 20 characters
+    template <typename T>
+    static char* appendNumber(char* out, T value, int base = 10) {
+        return std::to_chars(out, out + 20, value, base).ptr;
+    }
+
+    template <size_t N>
+    static char* appendText(char* out, const char (&text)[N]) {
+        std::memcpy(out, text, N - 1);
+        return out + N - 1;
+    }
+
+    // Splits each 32-bit sample into its low (first in memory) and high 16-bit halves
+    static void splitSamples(const uint32_t* samples, int numSamples, uint16_t* low, uint16_t* high) {
+        int i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+        if (__builtin_cpu_supports("avx2")) i = splitSamplesAvx2(samples, numSamples, low, high);
+#endif
+        for (; i < numSamples; ++i) {
+            low[i] = static_cast<uint16_t>(samples[i]);
+            high[i] = static_cast<uint16_t>(samples[i] >> 16);
         }
     }
+
+#if defined(__x86_64__) || defined(__i386__)
+    // Eight samples per step: one shuffle gathers the low and high halves of each 128-bit lane,
+    // a cross-lane permute lines them up, and each half is stored with one write
+    __attribute__((target("avx2")))
+    static int splitSamplesAvx2(const uint32_t* samples, int numSamples, uint16_t* low, uint16_t* high) {
+        const __m256i halves = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15,
+                                                0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+        int i = 0;
+        for (; i + 8 <= numSamples; i += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i));
+            v = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(v, halves), 0xD8);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(low + i), _mm256_castsi256_si128(v));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(high + i), _mm256_extracti128_si256(v, 1));
+        }
+        return i;
+    }
+#endif
+
+    // Reused from frame to frame
+    std::vector<uint32_t> m_payload;
+    std::vector<uint16_t> m_adc_tm1;
+    std::vector<uint16_t> m_adc;
+    std::vector<char> m_text;
 };
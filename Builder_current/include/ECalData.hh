@@ -4,11 +4,11 @@
 #pragma once
 #include <string>
 #include <vector>
-#include "ECalFrame.hh"
+#include "FrameArena.hh"
 
 // Payload for the ECal system
 struct ECalData {
     long long timestamp;
-    std::vector<ECalFrame> frames;
+    FrameArena frames; // all frame words contiguous, see FrameArena.hh
 };
 #endif
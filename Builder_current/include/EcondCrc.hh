@@ -0,0 +1,138 @@
+// EcondCrc.hh
+#ifndef ECONDCRC_H
+#define ECONDCRC_H
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ECOND_CRC_X86 1
+#endif
+
+/*
+CRC of an ECON-D packet: CRC-32 with polynomial 0x04C11DB7, processed most significant bit first,
+initial value 0 and no final xor, over the payload words before the CRC word. Each 32-bit word is
+fed most significant bit first, so the words can be consumed as they are, with no byte reordering.
+
+Two engines compute it:
+  - slice-by-8 tables, eight bytes (two words) per step, on any CPU;
+  - carry-less multiply folding (PCLMULQDQ, detected at run time), which folds four 128-bit lanes
+    of the message at a time and hands the final 128 bits and any tail words to the tables.
+*/
+namespace econd {
+    constexpr uint32_t kCrcPolynomial = 0x04C11DB7;
+
+    // x^n mod P, for the folding constants
+    constexpr uint32_t crc_xpow_mod(unsigned n) {
+        uint32_t r = 1;
+        for (unsigned i = 0; i < n; ++i) r = (r & 0x80000000u) ? (r << 1) ^ kCrcPolynomial : r << 1;
+        return r;
+    }
+
+    // table[k][b]: CRC contribution of byte b followed by k zero bytes
+    struct CrcTables {
+        uint32_t table[8][256] = {};
+
+        constexpr CrcTables() {
+            for (uint32_t b = 0; b < 256; ++b) {
+                uint32_t crc = b << 24;
+                for (int bit = 0; bit < 8; ++bit) crc = (crc & 0x80000000u) ? (crc << 1) ^ kCrcPolynomial : crc << 1;
+                table[0][b] = crc;
+            }
+            for (int k = 1; k < 8; ++k) {
+                for (uint32_t b = 0; b < 256; ++b) {
+                    uint32_t prev = table[k - 1][b];
+                    table[k][b] = (prev << 8) ^ table[0][prev >> 24];
+                }
+            }
+        }
+    };
+    inline constexpr CrcTables kCrcTables{};
+
+    // Continues crc over num_words words with the tables
+    inline uint32_t crc32_update_tables(uint32_t crc, const uint32_t* words, size_t num_words) {
+        const auto& t = kCrcTables.table;
+        size_t i = 0;
+        for (; i + 2 <= num_words; i += 2) {
+            uint32_t a = crc ^ words[i];
+            uint32_t b = words[i + 1];
+            crc = t[7][a >> 24] ^ t[6][(a >> 16) & 0xFF] ^ t[5][(a >> 8) & 0xFF] ^ t[4][a & 0xFF]
+                ^ t[3][b >> 24] ^ t[2][(b >> 16) & 0xFF] ^ t[1][(b >> 8) & 0xFF] ^ t[0][b & 0xFF];
+        }
+        if (i < num_words) {
+            uint32_t a = crc ^ words[i];
+            crc = t[3][a >> 24] ^ t[2][(a >> 16) & 0xFF] ^ t[1][(a >> 8) & 0xFF] ^ t[0][a & 0xFF];
+        }
+        return crc;
+    }
+
+#ifdef ECOND_CRC_X86
+    /*
+    A 128-bit lane holds four message words with the first word in the top 32 bits, so bit i of the
+    lane is the coefficient of x^i. Moving a lane forward over d bits of message multiplies it by
+    x^d: its high and low 64-bit halves are carry-less multiplied by x^(d+64) mod P and x^d mod P.
+    */
+    __attribute__((target("pclmul,sse4.1")))
+    inline __m128i crc_fold(__m128i lane, __m128i constants, __m128i next) {
+        __m128i high = _mm_clmulepi64_si128(lane, constants, 0x11);
+        __m128i low = _mm_clmulepi64_si128(lane, constants, 0x00);
+        return _mm_xor_si128(_mm_xor_si128(high, low), next);
+    }
+
+    // Four words from memory as a lane, first word on top
+    __attribute__((target("pclmul,sse4.1")))
+    inline __m128i crc_load_lane(const uint32_t* words) {
+        return _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(words)), 0x1B);
+    }
+
+    __attribute__((target("pclmul,sse4.1")))
+    inline __m128i crc_fold_constants(unsigned distance) {
+        return _mm_set_epi64x(crc_xpow_mod(distance + 64), crc_xpow_mod(distance));
+    }
+
+    // Requires num_words >= 16
+    __attribute__((target("pclmul,sse4.1")))
+    inline uint32_t crc32_clmul(const uint32_t* words, size_t num_words) {
+        static const __m128i fold512 = crc_fold_constants(512);
+        static const __m128i fold384 = crc_fold_constants(384);
+        static const __m128i fold256 = crc_fold_constants(256);
+        static const __m128i fold128 = crc_fold_constants(128);
+
+        __m128i a0 = crc_load_lane(words);
+        __m128i a1 = crc_load_lane(words + 4);
+        __m128i a2 = crc_load_lane(words + 8);
+        __m128i a3 = crc_load_lane(words + 12);
+        size_t i = 16;
+        for (; i + 16 <= num_words; i += 16) {
+            a0 = crc_fold(a0, fold512, crc_load_lane(words + i));
+            a1 = crc_fold(a1, fold512, crc_load_lane(words + i + 4));
+            a2 = crc_fold(a2, fold512, crc_load_lane(words + i + 8));
+            a3 = crc_fold(a3, fold512, crc_load_lane(words + i + 12));
+        }
+        __m128i lane = crc_fold(a0, fold384, crc_fold(a1, fold256, crc_fold(a2, fold128, a3)));
+        for (; i + 4 <= num_words; i += 4) lane = crc_fold(lane, fold128, crc_load_lane(words + i));
+
+        // The lane is congruent to the message so far: its CRC, continued over the tail, is the answer
+        alignas(16) uint32_t rest[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(rest), _mm_shuffle_epi32(lane, 0x1B));
+        return crc32_update_tables(crc32_update_tables(0, rest, 4), words + i, num_words - i);
+    }
+
+    inline bool crc32_has_clmul() {
+        static const bool available = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+        return available;
+    }
+#endif
+
+    // CRC of num_words words; accelerated selects the folding engine where the CPU has it
+    inline uint32_t crc32(const uint32_t* words, size_t num_words, bool accelerated = true) {
+#ifdef ECOND_CRC_X86
+        if (accelerated && num_words >= 16 && crc32_has_clmul()) return crc32_clmul(words, num_words);
+#else
+        (void)accelerated;
+#endif
+        return crc32_update_tables(0, words, num_words);
+    }
+}
+#endif
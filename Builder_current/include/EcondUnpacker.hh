@@ -0,0 +1,536 @@
+// EcondUnpacker.hh
+#ifndef ECONDUNPACKER_H
+#define ECONDUNPACKER_H
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include "FrameView.hh"
+#include "EcondCrc.hh"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ECOND_X86 1
+#endif
+
+/*
+ECON-D event packet layout, as carried in HCal/ECal frames (32-bit words, most significant bit first):
+
+  header word 0   [31:23] marker  [22:14] payload length in words  [13] P (passthrough)  [12] E  ...
+  header word 1   [31:20] BX  [19:14] event  [13:11] orbit  ...  [7:0] header CRC
+  per eRx (link) sub-packet:
+    word 0        [31:29] Stat  [28:26] Ham  [25] F (empty)  [24:15] CM0  [14:5] CM1  [4:0] channel map 36:32
+    word 1        channel map 31:0 (only if F == 0)
+    channel data  one variable-width record per channel set in the map, bit-packed, padded to a word
+  packet CRC      last payload word, see EcondCrc.hh
+
+Packets in a frame may be preceded, separated and followed by idle words or zero padding.
+
+In zero-suppressed mode every channel record starts with a 4-bit code giving its width and fields:
+  0000  24 bits  adc_tm1, adc          0010  24 bits  adc_tm1, adc
+  0001  16 bits  (2 reserved) adc      0011  24 bits  adc, toa
+  01xx  32 bits  TcTp, adc_tm1, adc, toa
+  1xxx  32 bits  TcTp, adc_tm1, tot, toa
+In passthrough mode every record is 32 bits: TcTp, adc_tm1, then adc or tot, then toa.
+*/
+namespace econd {
+    constexpr uint32_t kMarkerShift = 23;
+    constexpr uint32_t kPayloadLengthShift = 14;
+    constexpr uint32_t kPayloadLengthMask = 0x1FF;
+    constexpr uint32_t kPassthroughBit = 1u << 13;
+    constexpr uint32_t kLinkStatShift = 29;
+    constexpr uint32_t kLinkHammingShift = 26;
+    constexpr uint32_t kLinkHammingMask = 0x7;
+    constexpr uint32_t kEmptyLinkBit = 1u << 25;
+    constexpr uint32_t kChannelMapHighMask = 0x1F;
+    constexpr size_t kHeaderWords = 2;
+    constexpr size_t kMaxChannels = 37;
+
+    /*
+    Records fall into eight classes with a fixed field layout each: the four short zero-suppressed
+    codes, the three TcTp variants of the 32-bit record, and the passthrough TcTp == 00 record.
+    Fields are read from the record left-aligned in a 32-bit word as (record >> shift) & mask;
+    a zero mask means the class does not carry that field.
+    */
+    constexpr int kClasses = 8;
+    constexpr uint32_t kRecordBits[kClasses]   = {24, 16, 24, 24, 32, 32, 32, 32};
+    constexpr uint32_t kAdcTm1Shift[kClasses]  = {18, 0, 18, 0, 20, 20, 20, 20};
+    constexpr uint32_t kAdcTm1Mask[kClasses]   = {0x3FF, 0, 0x3FF, 0, 0x3FF, 0x3FF, 0x3FF, 0x3FF};
+    constexpr uint32_t kAdcShift[kClasses]     = {8, 16, 8, 18, 10, 0, 0, 10};
+    constexpr uint32_t kAdcMask[kClasses]      = {0x3FF, 0x3FF, 0x3FF, 0x3FF, 0x3FF, 0, 0, 0x3FF};
+    constexpr uint32_t kTotShift[kClasses]     = {0, 0, 0, 0, 0, 10, 10, 0};
+    constexpr uint32_t kTotMask[kClasses]      = {0, 0, 0, 0, 0, 0x3FF, 0x3FF, 0};
+    constexpr uint32_t kToaShift[kClasses]     = {0, 0, 0, 8, 0, 0, 0, 0};
+    constexpr uint32_t kToaMask[kClasses]      = {0, 0, 0, 0x3FF, 0x3FF, 0x3FF, 0x3FF, 0x3FF};
+    constexpr uint32_t kTcTpMask[kClasses]     = {0, 0, 0, 0, 1, 1, 1, 1};
+
+    // Class of a left-aligned record
+    inline uint32_t record_class(uint32_t record, bool passthrough) {
+        uint32_t tctp = record >> 30;
+        if (passthrough) return tctp == 0 ? 7 : tctp + 3;
+        uint32_t code = record >> 28;
+        return code < 4 ? code : (code >> 2) + 3;
+    }
+}
+
+// Unpacked hits, structure-of-arrays: entry i of every array belongs to the same channel sample
+struct EcondHits {
+    std::vector<uint8_t> link;      // eRx sub-packet index within its packet
+    std::vector<uint8_t> channel;   // 0-36, the bit position in the channel map
+    std::vector<uint8_t> tc;
+    std::vector<uint8_t> tp;
+    std::vector<uint16_t> adc_tm1;
+    std::vector<uint16_t> adc;
+    std::vector<uint16_t> tot;
+    std::vector<uint16_t> toa;
+
+    size_t size() const { return channel.size(); }
+
+    void clear() { resize(0); }
+
+    void resize(size_t n) {
+        link.resize(n);
+        channel.resize(n);
+        tc.resize(n);
+        tp.resize(n);
+        adc_tm1.resize(n);
+        adc.resize(n);
+        tot.resize(n);
+        toa.resize(n);
+    }
+};
+
+// What the unpacker checks, and which words may pad packets within a frame
+struct EcondValidation {
+    bool check_crc = true;               // drop packets whose CRC word does not match the payload
+    uint32_t header_marker = 0x1E6;      // header word 0 bits 31:23
+    uint32_t idle_pattern = 0xACCCCC00;  // idle words: (word & idle_mask) == idle_pattern
+    uint32_t idle_mask = 0xFFFFFF00;
+    uint32_t good_link_stat = 0x7;       // eRx Stat of a healthy link; links with any other Stat are dropped
+    bool check_link_hamming = true;      // drop links whose eRx header reports a Hamming error
+};
+
+enum class EcondFault : uint8_t {
+    BadMarker,    // no packet header where one was expected; the rest of the frame is skipped
+    Truncated,    // payload length runs past the end of the frame; the rest of the frame is skipped
+    BadCrc,       // packet CRC mismatch; the packet is dropped
+    LinkStat,     // eRx Stat not good; the link is dropped
+    LinkHamming,  // eRx header Hamming error; the link is dropped
+    LinkOverrun   // records run past the payload; this and the packet's later links are dropped
+};
+
+// A problem found while unpacking: packet is the packet's index in the frame
+struct EcondFaultRecord {
+    static constexpr uint8_t kWholePacket = 0xFF;
+
+    uint16_t packet;
+    uint8_t link;  // eRx index, or kWholePacket
+    EcondFault fault;
+};
+
+struct EcondUnpackStats {
+    uint64_t packets = 0;
+    uint64_t links = 0;
+    uint64_t hits = 0;
+    uint64_t idle_words = 0;         // idle and zero padding words skipped between packets
+    uint64_t crc_errors = 0;         // packets dropped for a CRC mismatch
+    uint64_t dropped_links = 0;      // links dropped for their Stat, Hamming or structure
+    uint64_t malformed_packets = 0;  // marker, length or sub-packet structure inconsistent with the frame
+};
+
+/**
+ * Unpacks ECON-D event packets into EcondHits.
+ *
+ * Work per packet is proportional to the data actually present, not to the 37-channel maximum:
+ *
+ *   - Channel maps become channel indices with popcount and count-trailing-zeros (or, built with
+ *     BMI2, one pdep per hit), so empty channels cost nothing.
+ *   - Records are always a whole number of bytes long, so one pass over the payload (32 bytes at
+ *     a time with AVX2) tabulates the record length that would start at every byte. Finding a
+ *     sub-packet's record offsets is then a chain of table lookups, p += step[p], with no
+ *     per-channel branch. The chain runs through the whole packet and sets the unpack rate.
+ *   - Each record is copied left-aligned into a scratch word as the chain reaches it, off the
+ *     chain's critical path, and fields are extracted for the whole packet at once as table-driven shifts
+ *     and masks; on CPUs with AVX2 eight records are decoded per instruction, with the per-class
+ *     shifts and masks picked by a lane permute.
+ *
+ * Damage is contained at the smallest unit that can be trusted again. A packet whose CRC fails is
+ * dropped, but its length still delimits it, so later packets in the frame are unpacked. A link
+ * whose eRx header reports bad Stat or a Hamming error is dropped on its own; its channel map still
+ * gives its length. Each problem is recorded in faults() for the last frame and counted in stats().
+ */
+class EcondUnpacker {
+public:
+    explicit EcondUnpacker(const EcondValidation& validation = EcondValidation()) : m_validation(validation) {
+#ifdef ECOND_X86
+        m_use_avx2 = __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    // For benchmarking: force the portable kernel even where AVX2 is available
+    void set_simd(bool enabled) {
+#ifdef ECOND_X86
+        m_use_avx2 = enabled && __builtin_cpu_supports("avx2");
+#else
+        (void)enabled;
+#endif
+    }
+    bool simd() const { return m_use_avx2; }
+
+    bool unpack(const FrameView& frame, EcondHits& hits) { return unpack(frame.words, frame.size(), hits); }
+
+    /*
+    Unpacks the event packets in a frame of num_words words and appends their hits. Returns true
+    if nothing had to be dropped; otherwise faults() says what was and why.
+    */
+    bool unpack(const uint32_t* words, size_t num_words, EcondHits& hits) {
+        m_faults.clear();
+        size_t pos = skip_padding(words, 0, num_words);
+        uint16_t packet = 0;
+        while (pos < num_words) {
+            size_t used = unpack_packet(words + pos, num_words - pos, packet, hits);
+            if (used == 0) break;
+            pos = skip_padding(words, pos + used, num_words);
+            ++packet;
+        }
+        return m_faults.empty();
+    }
+
+    const std::vector<EcondFaultRecord>& faults() const { return m_faults; }
+    const EcondUnpackStats& stats() const { return m_stats; }
+    const EcondValidation& validation() const { return m_validation; }
+
+private:
+    // Longest run of step[] reads past the payload: 37 records of 4 bytes from the last word
+    static constexpr size_t kStepPadding = econd::kMaxChannels * 4 + 4;
+
+    void fault(uint16_t packet, uint8_t link, EcondFault what) { m_faults.push_back({packet, link, what}); }
+
+    bool is_padding(uint32_t word) const {
+        return word == 0 || (word & m_validation.idle_mask) == m_validation.idle_pattern;
+    }
+
+    // Index of the first word at or after pos that is not idle or padding
+    size_t skip_padding(const uint32_t* words, size_t pos, size_t num_words) {
+        size_t start = pos;
+#ifdef ECOND_X86
+        if (m_use_avx2) pos = skip_padding_avx2(words, pos, num_words);
+#endif
+        while (pos < num_words && is_padding(words[pos])) ++pos;
+        m_stats.idle_words += pos - start;
+        return pos;
+    }
+
+    /*
+    Unpacks the packet at the start of words. Returns the words it spans, or 0 if its header cannot
+    be trusted to delimit it, in which case the rest of the frame is left alone.
+    */
+    size_t unpack_packet(const uint32_t* words, size_t num_words, uint16_t packet, EcondHits& hits) {
+        ++m_stats.packets;
+        if ((words[0] >> econd::kMarkerShift) != m_validation.header_marker) {
+            ++m_stats.malformed_packets;
+            fault(packet, EcondFaultRecord::kWholePacket, EcondFault::BadMarker);
+            return 0;
+        }
+        size_t payload_words = (words[0] >> econd::kPayloadLengthShift) & econd::kPayloadLengthMask;
+        if (num_words < econd::kHeaderWords || payload_words == 0 || payload_words > num_words - econd::kHeaderWords) {
+            ++m_stats.malformed_packets;
+            fault(packet, EcondFaultRecord::kWholePacket, EcondFault::Truncated);
+            return 0;
+        }
+        size_t packet_words = econd::kHeaderWords + payload_words;
+        bool passthrough = (words[0] & econd::kPassthroughBit) != 0;
+
+        // Sub-packets, without the packet CRC that ends the payload
+        const uint32_t* stream = words + econd::kHeaderWords;
+        size_t stream_words = payload_words - 1;
+        if (m_validation.check_crc && econd::crc32(stream, stream_words) != stream[stream_words]) {
+            ++m_stats.crc_errors;
+            fault(packet, EcondFaultRecord::kWholePacket, EcondFault::BadCrc);
+            return packet_words;
+        }
+        if (!passthrough) tabulate_record_lengths(stream, stream_words);
+
+        // Every record is at least 16 bits, which bounds the hits the payload can hold
+        size_t first_hit = hits.size();
+        size_t max_hits = stream_words * 2;
+        hits.resize(first_hit + max_hits);
+        if (m_records.size() < max_hits) m_records.resize(max_hits);
+
+        size_t n = 0;
+        size_t pos = 0;
+        uint8_t link = 0;
+        for (; pos < stream_words; ++link) {
+            uint32_t header = stream[pos];
+            ++m_stats.links;
+            bool keep = link_header_ok(header, packet, link);
+            if (header & econd::kEmptyLinkBit) {
+                ++pos;
+                continue;
+            }
+            if (pos + 2 > stream_words) {
+                overrun(packet, link);
+                break;
+            }
+            uint64_t channel_map = (static_cast<uint64_t>(header & econd::kChannelMapHighMask) << 32) | stream[pos + 1];
+            pos += 2;
+
+            size_t count = static_cast<size_t>(__builtin_popcountll(channel_map));
+            if (n + count > max_hits) {
+                overrun(packet, link);
+                break;
+            }
+            uint32_t* records = m_records.data() + n;
+            size_t body_end = read_records(stream, stream_words, pos * sizeof(uint32_t), count, passthrough, records);
+            size_t body_words = (body_end + sizeof(uint32_t) - 1) / sizeof(uint32_t) - pos;
+            if (pos + body_words > stream_words) {
+                overrun(packet, link);
+                break;
+            }
+            pos += body_words;
+            if (!keep) continue;
+
+            channel_indices(channel_map, count, hits.channel.data() + first_hit + n);
+            std::fill_n(hits.link.data() + first_hit + n, count, link);
+            n += count;
+        }
+
+        hits.resize(first_hit + n);
+        extract_fields(m_records.data(), n, passthrough, hits, first_hit);
+        m_stats.hits += n;
+        return packet_words;
+    }
+
+    // Checks an eRx header's Stat and Hamming bits; a bad link is recorded and should be dropped
+    bool link_header_ok(uint32_t header, uint16_t packet, uint8_t link) {
+        if ((header >> econd::kLinkStatShift) != m_validation.good_link_stat) {
+            ++m_stats.dropped_links;
+            fault(packet, link, EcondFault::LinkStat);
+            return false;
+        }
+        if (m_validation.check_link_hamming && ((header >> econd::kLinkHammingShift) & econd::kLinkHammingMask) != 0) {
+            ++m_stats.dropped_links;
+            fault(packet, link, EcondFault::LinkHamming);
+            return false;
+        }
+        return true;
+    }
+
+    void overrun(uint16_t packet, uint8_t link) {
+        ++m_stats.dropped_links;
+        ++m_stats.malformed_packets;
+        fault(packet, link, EcondFault::LinkOverrun);
+    }
+
+    /*
+    m_step[b] = length in bytes of a zero-suppressed record starting at byte b of the stream, from
+    the code in that byte's high nibble: 4 for codes 4-15, 2 for code 1, else 3. Computed for the
+    four bytes of a word at once; byte b of the stream is bits [31 - 8(b % 4), 24 - 8(b % 4)] of
+    word b / 4.
+    */
+    void tabulate_record_lengths(const uint32_t* stream, size_t stream_words) {
+        static_assert(econd::kRecordBits[0] == 24 && econd::kRecordBits[1] == 16 && econd::kRecordBits[2] == 24 &&
+                      econd::kRecordBits[3] == 24 && econd::kRecordBits[4] == 32, "record lengths changed");
+        size_t bytes = stream_words * sizeof(uint32_t);
+        if (m_step.size() < bytes + kStepPadding) m_step.resize(bytes + kStepPadding, 4);
+        uint8_t* step = m_step.data();
+        size_t i = 0;
+#ifdef ECOND_X86
+        if (m_use_avx2) i = tabulate_record_lengths_avx2(stream, stream_words, step);
+#endif
+        for (; i < stream_words; ++i) {
+            uint32_t code = (stream[i] >> 4) & 0x0F0F0F0F;                 // one code per byte
+            uint32_t wide = ((code >> 2) | (code >> 3)) & 0x01010101;       // code >= 4
+            uint32_t not_one = code ^ 0x01010101;
+            not_one = (not_one | (not_one >> 1) | (not_one >> 2) | (not_one >> 3)) & 0x01010101;
+            uint32_t lengths = 0x02020202 + wide + not_one;                 // 2, 3 or 4 per byte
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            lengths = __builtin_bswap32(lengths);                           // stream byte 0 is the high byte
+#endif
+            std::memcpy(step + i * sizeof(uint32_t), &lengths, sizeof(lengths));
+        }
+        std::memset(step + bytes, 4, kStepPadding);
+    }
+
+    /*
+    Copies count records starting at byte start (from the stream start) left-aligned into records;
+    returns the end byte. Each record's offset comes from the one before it through step[], a chain
+    of dependent loads that sets the pace of the whole unpack; the record load and shifts hang off
+    the chain rather than lengthening it, so they are done in the same loop instead of a pass of
+    their own. The caller checks the end byte against the stream afterwards, so until then reads
+    are clamped to the stream and the CRC word after it; an overrunning link is dropped anyway.
+    */
+    size_t read_records(const uint32_t* stream, size_t stream_words, size_t start, size_t count, bool passthrough,
+                        uint32_t* records) const {
+        if (passthrough) {
+            size_t first = start / sizeof(uint32_t);
+            size_t available = first < stream_words ? stream_words - first : 0;
+            std::memcpy(records, stream + first, std::min(count, available) * sizeof(uint32_t));
+            return start + count * sizeof(uint32_t);
+        }
+        const uint8_t* step = m_step.data();
+        const size_t last_index = stream_words - 1; // stream[last_index + 1] is the CRC word
+        uint32_t p = static_cast<uint32_t>(start);
+        for (size_t k = 0; k < count; ++k) {
+            size_t index = std::min<size_t>(p / sizeof(uint32_t), last_index);
+            uint64_t pair = (static_cast<uint64_t>(stream[index]) << 32) | stream[index + 1];
+            records[k] = static_cast<uint32_t>((pair << ((p % sizeof(uint32_t)) * 8)) >> 32);
+            p += step[p];
+        }
+        return p;
+    }
+
+    // Positions of the count set bits of channel_map, lowest first
+    static void channel_indices(uint64_t channel_map, size_t count, uint8_t* channels) {
+#ifdef __BMI2__
+        // The k-th set bit, found directly: no dependency from one hit to the next
+        for (size_t k = 0; k < count; ++k) {
+            channels[k] = static_cast<uint8_t>(__builtin_ctzll(_pdep_u64(1ull << k, channel_map)));
+        }
+#else
+        for (size_t k = 0; k < count; ++k) {
+            channels[k] = static_cast<uint8_t>(__builtin_ctzll(channel_map));
+            channel_map &= channel_map - 1;
+        }
+#endif
+    }
+
+    void extract_fields(const uint32_t* records, size_t n, bool passthrough, EcondHits& hits, size_t first) {
+        size_t done = 0;
+#ifdef ECOND_X86
+        if (m_use_avx2) done = extract_fields_avx2(records, n, passthrough, hits, first);
+#endif
+        extract_fields_scalar(records + done, n - done, passthrough, hits, first + done);
+    }
+
+    static void extract_fields_scalar(const uint32_t* records, size_t n, bool passthrough, EcondHits& hits, size_t first) {
+        for (size_t i = 0; i < n; ++i) {
+            uint32_t r = records[i];
+            uint32_t c = econd::record_class(r, passthrough);
+            hits.tc[first + i] = static_cast<uint8_t>((r >> 31) & econd::kTcTpMask[c]);
+            hits.tp[first + i] = static_cast<uint8_t>((r >> 30) & econd::kTcTpMask[c]);
+            hits.adc_tm1[first + i] = static_cast<uint16_t>((r >> econd::kAdcTm1Shift[c]) & econd::kAdcTm1Mask[c]);
+            hits.adc[first + i] = static_cast<uint16_t>((r >> econd::kAdcShift[c]) & econd::kAdcMask[c]);
+            hits.tot[first + i] = static_cast<uint16_t>((r >> econd::kTotShift[c]) & econd::kTotMask[c]);
+            hits.toa[first + i] = static_cast<uint16_t>((r >> econd::kToaShift[c]) & econd::kToaMask[c]);
+        }
+    }
+
+#ifdef ECOND_X86
+    // Eight records per iteration; returns how many records it handled (a multiple of 8)
+    __attribute__((target("avx2")))
+    static size_t extract_fields_avx2(const uint32_t* records, size_t n, bool passthrough, EcondHits& hits, size_t first) {
+        const __m256i adc_tm1_shift = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(econd::kAdcTm1Shift));
+        const __m256i adc_tm1_mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(econd::kAdcTm1Mask));
+        const __m256i adc_shift = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(econd::kAdcShift));
+        const __m256i adc_mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(econd::kAdcMask));
+        const __m256i tot_shift = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(econd::kTotShift));
+        const __m256i tot_mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(econd::kTotMask));
+        const __m256i toa_shift = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(econd::kToaShift));
+        const __m256i toa_mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(econd::kToaMask));
+        const __m256i tctp_mask = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(econd::kTcTpMask));
+        const __m256i three = _mm256_set1_epi32(3);
+        const __m256i seven = _mm256_set1_epi32(7);
+        const __m256i zero = _mm256_setzero_si256();
+
+        size_t i = 0;
+        for (; i + 8 <= n; i += 8) {
+            __m256i r = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(records + i));
+
+            // Class per lane, as in econd::record_class
+            __m256i c;
+            if (passthrough) {
+                __m256i tctp = _mm256_srli_epi32(r, 30);
+                c = _mm256_blendv_epi8(_mm256_add_epi32(tctp, three), seven, _mm256_cmpeq_epi32(tctp, zero));
+            } else {
+                __m256i code = _mm256_srli_epi32(r, 28);
+                __m256i wide = _mm256_add_epi32(_mm256_srli_epi32(code, 2), three);
+                c = _mm256_blendv_epi8(code, wide, _mm256_cmpgt_epi32(code, three));
+            }
+
+            __m256i lane_tctp = _mm256_permutevar8x32_epi32(tctp_mask, c);
+            __m256i tc = _mm256_and_si256(_mm256_srli_epi32(r, 31), lane_tctp);
+            __m256i tp = _mm256_and_si256(_mm256_srli_epi32(r, 30), lane_tctp);
+
+            store16(hits.adc_tm1.data() + first + i, field(r, c, adc_tm1_shift, adc_tm1_mask));
+            store16(hits.adc.data() + first + i, field(r, c, adc_shift, adc_mask));
+            store16(hits.tot.data() + first + i, field(r, c, tot_shift, tot_mask));
+            store16(hits.toa.data() + first + i, field(r, c, toa_shift, toa_mask));
+            store8(hits.tc.data() + first + i, tc);
+            store8(hits.tp.data() + first + i, tp);
+        }
+        return i;
+    }
+
+    // Eight words per step; returns the first non-padding word, or where fewer than eight words remain
+    __attribute__((target("avx2")))
+    size_t skip_padding_avx2(const uint32_t* words, size_t pos, size_t num_words) const {
+        const __m256i mask = _mm256_set1_epi32(static_cast<int>(m_validation.idle_mask));
+        const __m256i idle = _mm256_set1_epi32(static_cast<int>(m_validation.idle_pattern));
+        const __m256i zero = _mm256_setzero_si256();
+        for (; pos + 8 <= num_words; pos += 8) {
+            __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + pos));
+            __m256i padding = _mm256_or_si256(_mm256_cmpeq_epi32(_mm256_and_si256(w, mask), idle),
+                                              _mm256_cmpeq_epi32(w, zero));
+            unsigned lanes = static_cast<unsigned>(_mm256_movemask_ps(_mm256_castsi256_ps(padding)));
+            if (lanes != 0xFF) return pos + static_cast<size_t>(__builtin_ctz(~lanes));
+        }
+        return pos;
+    }
+
+    // tabulate_record_lengths for eight words per iteration; returns how many words it handled
+    __attribute__((target("avx2")))
+    static size_t tabulate_record_lengths_avx2(const uint32_t* stream, size_t stream_words, uint8_t* step) {
+        const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+        const __m256i one = _mm256_set1_epi8(1);
+        const __m256i two = _mm256_set1_epi8(2);
+        const __m256i three = _mm256_set1_epi8(3);
+        // Stream byte b is byte 3 - b % 4 of its word in memory
+        const __m256i stream_order = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                                                      3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        size_t i = 0;
+        for (; i + 8 <= stream_words; i += 8) {
+            __m256i w = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(stream + i));
+            __m256i code = _mm256_and_si256(_mm256_srli_epi32(w, 4), low_nibble);
+            __m256i not_one = _mm256_andnot_si256(_mm256_cmpeq_epi8(code, one), one);
+            __m256i wide = _mm256_and_si256(_mm256_cmpgt_epi8(code, three), one);
+            __m256i lengths = _mm256_add_epi8(two, _mm256_add_epi8(not_one, wide));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(step + i * sizeof(uint32_t)),
+                                _mm256_shuffle_epi8(lengths, stream_order));
+        }
+        return i;
+    }
+
+    // (record >> shift[class]) & mask[class] per lane
+    __attribute__((target("avx2")))
+    static __m256i field(__m256i records, __m256i classes, __m256i shift, __m256i mask) {
+        return _mm256_and_si256(_mm256_srlv_epi32(records, _mm256_permutevar8x32_epi32(shift, classes)),
+                                _mm256_permutevar8x32_epi32(mask, classes));
+    }
+
+    // Narrows eight 32-bit lanes (each < 2^16) to 16 bits and stores them
+    __attribute__((target("avx2")))
+    static void store16(uint16_t* out, __m256i v) {
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(packed));
+    }
+
+    // Narrows eight 32-bit lanes (each < 2^8) to bytes and stores them
+    __attribute__((target("avx2")))
+    static void store8(uint8_t* out, __m256i v) {
+        __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+        __m128i bytes = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_castsi256_si128(words));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out), bytes);
+    }
+#endif
+
+    EcondValidation m_validation;
+    bool m_use_avx2 = false;
+    EcondUnpackStats m_stats;
+    std::vector<EcondFaultRecord> m_faults;  // for the last frame
+    std::vector<uint32_t> m_records;  // per packet: one left-aligned raw record per kept hit, in hit order
+    std::vector<uint8_t> m_step;      // per stream byte: length of a record starting there
+};
+#endif
@@ -0,0 +1,151 @@
+// EventArena.hh
+#ifndef EVENTARENA_H
+#define EVENTARENA_H
+#pragma once
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <cstddef>
+
+/**
+ * Monotonic memory for everything one event allocates: its frame arenas and readout list come
+ * out of one pre-allocated block by bumping a pointer, individual frees are no-ops, and the whole
+ * event is released at once by reset(). An arena serves one event, so one thread, at a time.
+ *
+ * If an event outgrows the block, the overflow comes from the heap in further chunks; reset()
+ * then enlarges the block (up to max_block_bytes) so the next event fits in one block again.
+ */
+class EventArena {
+public:
+    EventArena(size_t block_bytes, size_t max_block_bytes)
+        : m_block_bytes(block_bytes), m_max_block_bytes(max_block_bytes) {
+        make_resource();
+    }
+
+    EventArena(const EventArena&) = delete;
+    EventArena& operator=(const EventArena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &*m_resource; }
+
+    void reset() {
+        if (m_upstream.bytes != 0 && m_block_bytes < m_max_block_bytes) {
+            size_t wanted = m_block_bytes + m_upstream.bytes;
+            m_block_bytes = wanted < m_max_block_bytes ? wanted : m_max_block_bytes;
+            m_resource.reset();
+            m_upstream.bytes = 0;
+            make_resource();
+            return;
+        }
+        m_resource->release();
+        m_upstream.bytes = 0;
+    }
+
+    size_t block_bytes() const { return m_block_bytes; }
+
+private:
+    // Heap chunks taken past the end of the block, counted so reset() can size the block up
+    struct Upstream : std::pmr::memory_resource {
+        size_t bytes = 0;
+
+        void* do_allocate(size_t size, size_t alignment) override {
+            bytes += size;
+            return std::pmr::new_delete_resource()->allocate(size, alignment);
+        }
+        void do_deallocate(void* p, size_t size, size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, size, alignment);
+        }
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    void make_resource() {
+        m_block = std::make_unique<std::byte[]>(m_block_bytes);
+        m_resource.emplace(m_block.get(), m_block_bytes, &m_upstream);
+    }
+
+    size_t m_block_bytes;
+    size_t m_max_block_bytes;
+    std::unique_ptr<std::byte[]> m_block;
+    Upstream m_upstream;
+    std::optional<std::pmr::monotonic_buffer_resource> m_resource;
+};
+
+/**
+ * Recycles EventArenas between events. acquire() hands out a lease; when the lease is destroyed
+ * (with the event holding it) the arena is reset and goes back on the free list, so steady-state
+ * event building does no heap allocation at all. The pool's state is shared with outstanding
+ * leases, so events may outlive the EventArenaPool object itself.
+ *
+ * The free list is bounded both in arenas and in bytes of blocks: after a burst of large events
+ * the grown arenas beyond the byte budget are freed rather than pinned for the rest of the run.
+ */
+class EventArenaPool {
+    struct State {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<EventArena>> free;
+        size_t block_bytes;
+        size_t max_block_bytes;
+        size_t max_cached;
+        size_t max_cached_bytes;
+        size_t cached_bytes = 0;   // sum of block_bytes() over free
+        std::atomic<size_t> created{0};
+    };
+
+public:
+    // Returns a leased arena to its pool
+    struct Recycler {
+        std::shared_ptr<State> state;
+
+        void operator()(EventArena* arena) const {
+            arena->reset();
+            std::unique_ptr<EventArena> owned(arena);
+            std::lock_guard<std::mutex> lock(state->mutex);
+            size_t bytes = owned->block_bytes();
+            if (state->free.size() < state->max_cached && state->cached_bytes + bytes <= state->max_cached_bytes) {
+                state->cached_bytes += bytes;
+                state->free.push_back(std::move(owned));
+            }
+        }
+    };
+    using Lease = std::unique_ptr<EventArena, Recycler>;
+
+    /*
+    block_bytes:     initial block of each arena; it grows (up to max_block_bytes) after events that overflow it.
+    max_cached:      arenas kept on the free list; beyond that, returned arenas are freed.
+    max_cached_bytes: total block bytes kept on the free list; an arena that would go over it is freed.
+    */
+    EventArenaPool(size_t block_bytes = 64 * 1024, size_t max_block_bytes = 16 * 1024 * 1024, size_t max_cached = 1024,
+                   size_t max_cached_bytes = 256 * 1024 * 1024)
+        : m_state(std::make_shared<State>()) {
+        m_state->block_bytes = block_bytes;
+        m_state->max_block_bytes = max_block_bytes;
+        m_state->max_cached = max_cached;
+        m_state->max_cached_bytes = max_cached_bytes;
+    }
+
+    Lease acquire() {
+        std::unique_ptr<EventArena> arena;
+        {
+            std::lock_guard<std::mutex> lock(m_state->mutex);
+            if (!m_state->free.empty()) {
+                arena = std::move(m_state->free.back());
+                m_state->free.pop_back();
+                m_state->cached_bytes -= arena->block_bytes();
+            }
+        }
+        if (!arena) {
+            arena = std::make_unique<EventArena>(m_state->block_bytes, m_state->max_block_bytes);
+            m_state->created.fetch_add(1, std::memory_order_relaxed);
+        }
+        return Lease(arena.release(), Recycler{m_state});
+    }
+
+    // Arenas ever created, i.e. the peak number of events alive at once
+    size_t created() const { return m_state->created.load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<State> m_state;
+};
+#endif
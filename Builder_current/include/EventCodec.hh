@@ -0,0 +1,89 @@
+// EventCodec.hh
+#ifndef EVENTCODEC_H
+#define EVENTCODEC_H
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include "PhysicsEventData.hh"
+#include "BinaryReader.hh"
+
+/*
+Compact binary form of a (possibly partial) PhysicsEventData, used to ship events to merger
+processes and as the body of the writer's output records. All fields are native order:
+
+    uint64 event_id, int64 timestamp, uint32 readout count, uint8 subsystem ID per readout entry,
+    then for Tracker, HCal and ECal: uint32 frame count, uint32 word count,
+                                     uint32 words per frame, the words themselves
+
+The frame words go in as one block per subsystem, straight from the FrameArena.
+*/
+namespace event_codec {
+    template <typename T>
+    inline void put(std::vector<char>& out, T value) {
+        size_t at = out.size();
+        out.resize(at + sizeof(T));
+        std::memcpy(out.data() + at, &value, sizeof(T));
+    }
+
+    inline void put_frames(std::vector<char>& out, const FrameArena& frames) {
+        put<uint32_t>(out, static_cast<uint32_t>(frames.size()));
+        put<uint32_t>(out, static_cast<uint32_t>(frames.word_count()));
+        for (FrameView frame : frames) put<uint32_t>(out, frame.num_words);
+        size_t at = out.size();
+        size_t bytes = frames.word_count() * sizeof(uint32_t);
+        out.resize(at + bytes);
+        if (bytes != 0) std::memcpy(out.data() + at, frames.words(), bytes);
+    }
+
+    inline void get_frames(BinaryReader& reader, FrameArena& frames) {
+        uint32_t num_frames = 0;
+        uint32_t num_words = 0;
+        reader.read(num_frames);
+        reader.read(num_words);
+        const char* sizes = reader.skip(size_t(num_frames) * sizeof(uint32_t));
+        const char* words = reader.skip(size_t(num_words) * sizeof(uint32_t));
+        frames.reserve(frames.size() + num_frames, frames.word_count() + num_words);
+        size_t used = 0;
+        for (uint32_t i = 0; i < num_frames; ++i) {
+            uint32_t frame_words;
+            std::memcpy(&frame_words, sizes + i * sizeof(uint32_t), sizeof(frame_words));
+            if (frame_words > num_words - used) {
+                throw std::runtime_error("Encoded event frame sizes exceed its word count");
+            }
+            frames.append(words + used * sizeof(uint32_t), frame_words);
+            used += frame_words;
+        }
+    }
+
+    // Appends the encoding of event to out
+    inline void encode(const PhysicsEventData& event, std::vector<char>& out) {
+        put<uint64_t>(out, static_cast<uint64_t>(event.event_id));
+        put<int64_t>(out, event.timestamp);
+        put<uint32_t>(out, static_cast<uint32_t>(event.systems_readout.size()));
+        for (uint64_t subsystem : event.systems_readout) put<uint8_t>(out, static_cast<uint8_t>(subsystem));
+        put_frames(out, event.tracker_info.frames);
+        put_frames(out, event.hcal_info.frames);
+        put_frames(out, event.ecal_info.frames);
+    }
+
+    // Reads one encoded event into event (which should be empty); throws on truncated input
+    inline void decode(BinaryReader& reader, PhysicsEventData& event) {
+        uint64_t event_id = 0;
+        int64_t timestamp = 0;
+        uint32_t readouts = 0;
+        reader.read(event_id);
+        reader.read(timestamp);
+        reader.read(readouts);
+        event.event_id = static_cast<long long>(event_id);
+        event.timestamp = timestamp;
+        const char* ids = reader.skip(readouts);
+        event.systems_readout.assign(reinterpret_cast<const uint8_t*>(ids),
+                                     reinterpret_cast<const uint8_t*>(ids) + readouts);
+        get_frames(reader, event.tracker_info.frames);
+        get_frames(reader, event.hcal_info.frames);
+        get_frames(reader, event.ecal_info.frames);
+    }
+}
+#endif
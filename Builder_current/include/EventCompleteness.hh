@@ -0,0 +1,209 @@
+// EventCompleteness.hh
+#ifndef EVENTCOMPLETENESS_H
+#define EVENTCOMPLETENESS_H
+#pragma once
+#include <map>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <cstdint>
+#include <stdexcept>
+
+/**
+ * What a single subsystem is expected to contribute to one event.
+ *
+ * expected_fragments: number of fragments (one per link/module) the subsystem sends per event.
+ * link_mask: optional bitmap of the links (FragmentHeader::contributor_id) that must be seen.
+ *            When non-zero it takes precedence over expected_fragments.
+ * required: optional subsystems are collected if present but never hold an event back.
+ */
+struct SubsystemRequirement {
+    uint64_t subsystem_id = 0;
+    unsigned int expected_fragments = 1;
+    uint64_t link_mask = 0;
+    bool required = true;
+};
+
+// What has actually arrived for a subsystem inside one candidate event window
+struct SubsystemTally {
+    unsigned int fragments = 0;
+    uint64_t links_seen = 0;
+
+    void add(uint64_t link) {
+        ++fragments;
+        if (link < 64) links_seen |= (uint64_t(1) << link);
+    }
+};
+
+class CompletenessModel {
+public:
+    using Tallies = std::map<uint64_t, SubsystemTally>;
+
+    // Upper bound on configured subsystems, so per-event tallies can live in a fixed array
+    static constexpr size_t kMaxSubsystems = 8;
+    using TallyArray = std::array<SubsystemTally, kMaxSubsystems>;
+
+    CompletenessModel() { m_index.fill(-1); }
+
+    // Matches the old hard-coded behaviour: at least one fragment from Tracker, HCal and ECal
+    static CompletenessModel default_model() {
+        CompletenessModel model;
+        for (uint64_t id = 0; id < 3; ++id) {
+            SubsystemRequirement req;
+            req.subsystem_id = id;
+            model.add_requirement(req);
+        }
+        return model;
+    }
+
+    /*
+    Loads the descriptor from a text file, one subsystem per line:
+
+        # subsystem_id, expected_fragments, link_mask, required
+        0, 4, 0x0, 1
+        1, 2, 0x0, 1
+        2, 2, 0x0, 0
+
+    Blank lines and lines starting with '#' are ignored. The listener does not receive the link
+    index yet (every fragment arrives with contributor_id 0), so a non-zero link_mask could never
+    be satisfied and is rejected; link masks can only be set through add_requirement for now.
+    */
+    static CompletenessModel load(const std::string& filename) {
+        std::ifstream infile(filename);
+        if (!infile.is_open()) {
+            throw std::runtime_error("Could not open completeness descriptor: " + filename);
+        }
+
+        CompletenessModel model;
+        std::string line;
+        while (std::getline(infile, line)) {
+            if (line.empty() || line[0] == '#') continue;
+            std::replace(line.begin(), line.end(), ',', ' ');
+            std::stringstream ss(line);
+            SubsystemRequirement req;
+            std::string mask;
+            int required = 1;
+            if (!(ss >> req.subsystem_id >> req.expected_fragments >> mask >> required)) {
+                std::cerr << "[Completeness] Skipping malformed line: " << line << std::endl;
+                continue;
+            }
+            req.link_mask = std::stoull(mask, nullptr, 0);
+            if (req.link_mask != 0) {
+                throw std::runtime_error("Subsystem " + std::to_string(req.subsystem_id) +
+                                         ": link_mask needs the link index on the wire, which the listener "
+                                         "does not receive yet; use expected_fragments instead");
+            }
+            req.required = required != 0;
+            model.add_requirement(req);
+        }
+        if (model.m_requirements.empty()) {
+            throw std::runtime_error("Completeness descriptor lists no subsystems: " + filename);
+        }
+        return model;
+    }
+
+    void add_requirement(const SubsystemRequirement& req) {
+        if (req.subsystem_id >= m_index.size()) {
+            throw std::runtime_error("Subsystem ID out of range: " + std::to_string(req.subsystem_id));
+        }
+        m_requirements[req.subsystem_id] = req;
+        int& index = m_index[req.subsystem_id];
+        if (index < 0) {
+            if (m_by_index.size() == kMaxSubsystems) {
+                throw std::runtime_error("Too many subsystems in completeness descriptor");
+            }
+            index = static_cast<int>(m_by_index.size());
+            m_by_index.push_back(req);
+        } else {
+            m_by_index[index] = req;
+        }
+    }
+
+    /*
+    Incremental interface used by the event-ID matcher: each configured subsystem has a dense
+    index, so an event keeps a TallyArray plus a count of required subsystems still outstanding
+    and completeness is an O(1) check as each fragment is attached.
+    */
+    int index_of(uint64_t subsystem_id) const {
+        return subsystem_id < m_index.size() ? m_index[subsystem_id] : -1;
+    }
+
+    bool is_required(int index) const { return m_by_index[index].required; }
+
+    bool is_satisfied(int index, const SubsystemTally& tally) const {
+        return satisfied(m_by_index[index], tally);
+    }
+
+    /*
+    Fragments a subsystem must deliver when only fragment counts are known (after assembly the
+    link of each fragment is gone): a link mask asks for one fragment per link in it.
+    */
+    unsigned int fragments_needed(int index) const {
+        const SubsystemRequirement& req = m_by_index[index];
+        if (req.link_mask != 0) return static_cast<unsigned int>(__builtin_popcountll(req.link_mask));
+        return req.expected_fragments;
+    }
+
+    // Required subsystems that an event with no fragments has not satisfied yet
+    unsigned int outstanding_when_empty() const {
+        unsigned int n = 0;
+        for (const auto& req : m_by_index) {
+            if (req.required && !satisfied(req, SubsystemTally{})) ++n;
+        }
+        return n;
+    }
+
+    // True once every required subsystem has delivered all of its expected fragments/links
+    bool is_complete(const Tallies& tallies) const {
+        for (const auto& pair : m_requirements) {
+            const SubsystemRequirement& req = pair.second;
+            if (!req.required) continue;
+            auto it = tallies.find(pair.first);
+            if (it == tallies.end()) return false;
+            if (!satisfied(req, it->second)) return false;
+        }
+        return true;
+    }
+
+    // Number of subsystems that must be present for an event to be complete
+    size_t required_subsystems() const {
+        size_t n = 0;
+        for (const auto& pair : m_requirements) {
+            if (pair.second.required) ++n;
+        }
+        return n;
+    }
+
+    const std::map<uint64_t, SubsystemRequirement>& requirements() const { return m_requirements; }
+
+    void print() const {
+        for (const auto& pair : m_requirements) {
+            const SubsystemRequirement& req = pair.second;
+            std::cout << "[Completeness] subsystem " << req.subsystem_id
+                      << (req.required ? " required" : " optional");
+            if (req.link_mask != 0) {
+                std::cout << ", link mask 0x" << std::hex << req.link_mask << std::dec;
+            } else {
+                std::cout << ", " << req.expected_fragments << " fragment(s)";
+            }
+            std::cout << std::endl;
+        }
+    }
+
+private:
+    static bool satisfied(const SubsystemRequirement& req, const SubsystemTally& tally) {
+        if (req.link_mask != 0) {
+            return (tally.links_seen & req.link_mask) == req.link_mask;
+        }
+        return tally.fragments >= req.expected_fragments;
+    }
+
+    std::map<uint64_t, SubsystemRequirement> m_requirements;
+    std::array<int, 256> m_index;   // subsystem_id (8-bit header field) -> dense index
+    std::vector<SubsystemRequirement> m_by_index;
+};
+#endif
@@ -0,0 +1,199 @@
+// EventIdTable.hh
+#ifndef EVENTIDTABLE_H
+#define EVENTIDTABLE_H
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+/**
+ * Open-addressing (linear probing) hash table keyed by event ID.
+ *
+ * Growth never rehashes in one go. Once the load factor passes 1/2 a table of twice the size is
+ * allocated and the old one is drained a few slots at a time on every later insert/erase, so no
+ * single call pays for moving millions of in-flight events. Lookups check both tables while the
+ * drain is in progress. The primary table uses backward-shift deletion (no tombstones); the
+ * draining table only ever loses entries, so it just marks them deleted.
+ *
+ * Growth still allocates and zeroes the whole new table, so V should be small: large per-event
+ * state belongs in a separate pool with the table mapping IDs to pool slots (EventIdTable<uint32_t>).
+ *
+ * References returned by find/find_or_insert are valid until the next insert or erase.
+ */
+template <typename V>
+class EventIdTable {
+public:
+    explicit EventIdTable(size_t expected_entries = 1024) {
+        size_t cap = 16;
+        while (cap < expected_entries * 2) cap <<= 1;
+        m_slots.resize(cap);
+    }
+
+    size_t size() const { return m_size + m_old_size; }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return m_slots.size(); }
+
+    V* find(uint64_t key) {
+        size_t pos;
+        if (probe(m_slots, key, pos)) return &m_slots[pos].value;
+        if (migrating() && probe(m_old, key, pos)) return &m_old[pos].value;
+        return nullptr;
+    }
+
+    // Returns the entry for key, default-constructing it if it is not there yet
+    V& find_or_insert(uint64_t key, bool& inserted) {
+        migrate_step();
+        inserted = false;
+        size_t pos;
+        if (migrating() && probe(m_old, key, pos)) return m_old[pos].value;
+        if (probe(m_slots, key, pos)) return m_slots[pos].value;
+
+        /*
+        A drain covers kMigrateBatch old slots per call, so it is over long before the primary table
+        doubles its entry count again; should one still be running, the insert just goes into the
+        primary table above half load rather than draining it here.
+        */
+        if ((m_size + 1) * 2 > m_slots.size() && !migrating()) {
+            start_growth();
+            probe(m_slots, key, pos);
+        }
+        Slot& slot = m_slots[pos];
+        slot.key = key;
+        slot.state = kFull;
+        ++m_size;
+        inserted = true;
+        return slot.value;
+    }
+
+    // Moves the entry for key into out and removes it. Returns false if the key is absent.
+    bool take(uint64_t key, V& out) {
+        migrate_step();
+        size_t pos;
+        if (migrating() && probe(m_old, key, pos)) {
+            out = std::move(m_old[pos].value);
+            m_old[pos].value = V();
+            m_old[pos].state = kDeleted;
+            --m_old_size;
+            return true;
+        }
+        if (probe(m_slots, key, pos)) {
+            out = std::move(m_slots[pos].value);
+            erase_at(pos);
+            return true;
+        }
+        return false;
+    }
+
+    bool erase(uint64_t key) {
+        V discarded;
+        return take(key, discarded);
+    }
+
+    template <typename Fn>
+    void for_each(Fn&& fn) {
+        for (auto& slot : m_old) {
+            if (slot.state == kFull) fn(slot.key, slot.value);
+        }
+        for (auto& slot : m_slots) {
+            if (slot.state == kFull) fn(slot.key, slot.value);
+        }
+    }
+
+    /*
+    Event IDs are mostly sequential; mix them so neighbouring IDs don't form long probe runs. The
+    table uses the low bits, so callers that split keys over several tables should use the high ones.
+    */
+    static size_t hash(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xff51afd7ed558ccdULL;
+        key ^= key >> 33;
+        key *= 0xc4ceb9fe1a85ec53ULL;
+        key ^= key >> 33;
+        return static_cast<size_t>(key);
+    }
+
+private:
+    static constexpr uint8_t kEmpty = 0;
+    static constexpr uint8_t kFull = 1;
+    static constexpr uint8_t kDeleted = 2;   // only ever used in the draining table
+    static constexpr size_t kMigrateBatch = 8;
+
+    struct Slot {
+        uint64_t key = 0;
+        uint8_t state = kEmpty;
+        V value{};
+    };
+
+    // On a hit pos is the key's slot; on a miss it is the first empty slot of the probe run
+    static bool probe(const std::vector<Slot>& table, uint64_t key, size_t& pos) {
+        const size_t mask = table.size() - 1;
+        pos = hash(key) & mask;
+        while (table[pos].state != kEmpty) {
+            if (table[pos].state == kFull && table[pos].key == key) return true;
+            pos = (pos + 1) & mask;
+        }
+        return false;
+    }
+
+    bool migrating() const { return !m_old.empty(); }
+
+    void start_growth() {
+        m_old = std::move(m_slots);
+        m_old_size = m_size;
+        m_size = 0;
+        m_cursor = 0;
+        m_slots = std::vector<Slot>(m_old.size() * 2);
+    }
+
+    // Moves up to kMigrateBatch slots from the draining table into the primary one
+    void migrate_step() {
+        if (!migrating()) return;
+        for (size_t n = 0; n < kMigrateBatch && m_cursor < m_old.size(); ++n, ++m_cursor) {
+            Slot& slot = m_old[m_cursor];
+            if (slot.state != kFull) continue;
+            size_t pos;
+            probe(m_slots, slot.key, pos);
+            m_slots[pos].key = slot.key;
+            m_slots[pos].state = kFull;
+            m_slots[pos].value = std::move(slot.value);
+            ++m_size;
+            slot.value = V();
+            slot.state = kDeleted;
+            --m_old_size;
+        }
+        if (m_cursor == m_old.size() || m_old_size == 0) {
+            std::vector<Slot>().swap(m_old);
+            m_old_size = 0;
+        }
+    }
+
+    // Backward-shift deletion keeps probe runs contiguous without tombstones
+    void erase_at(size_t pos) {
+        const size_t mask = m_slots.size() - 1;
+        size_t hole = pos;
+        size_t next = pos;
+        while (true) {
+            next = (next + 1) & mask;
+            if (m_slots[next].state != kFull) break;
+            size_t home = hash(m_slots[next].key) & mask;
+            // An entry whose home lies cyclically in (hole, next] cannot move back into the hole
+            bool stays = (hole <= next) ? (hole < home && home <= next) : (hole < home || home <= next);
+            if (stays) continue;
+            m_slots[hole].key = m_slots[next].key;
+            m_slots[hole].state = kFull;
+            m_slots[hole].value = std::move(m_slots[next].value);
+            hole = next;
+        }
+        m_slots[hole].state = kEmpty;
+        m_slots[hole].value = V();
+        --m_size;
+    }
+
+    std::vector<Slot> m_slots;
+    std::vector<Slot> m_old;
+    size_t m_size = 0;
+    size_t m_old_size = 0;
+    size_t m_cursor = 0;
+};
+#endif
@@ -1,77 +1,300 @@
 // EventMerger.hh
 #ifndef EVENTMERGER_H
 #define EVENTMERGER_H
-#include <map>
+#include <array>
+#include <vector>
+#include <queue>
+#include <memory>
 #include <mutex>
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <iostream>
 #include <algorithm>
 #include "PhysicsEventData.hh"
+#include "EventCompleteness.hh"
+#include "EventIdTable.hh"
+#include "BoundedQueue.hh"
 
+// An event leaving the merger: complete, or whatever had arrived when it was given up on
+struct MergedEvent {
+    PhysicsEventData event;
+    bool complete = false;
+};
+
+using MergedEventQueue = BoundedQueue<MergedEvent>;
+
+struct MergerConfig {
+    size_t shards = 8;                      // independently locked tables, rounded up to a power of two
+    size_t expected_in_flight = 1024;       // table pre-size, summed over shards
+    long long timeout_ns = 2000000000;      // a waiting event is given up this long after its first part, 0 = never
+};
+
+// Snapshot of the merger's counters
+struct MergerStatus {
+    size_t in_flight = 0;
+    size_t completed = 0;
+    size_t expired = 0;
+};
+
+/**
+ * Collects the parts of each event (complete builds, timed-out partial builds and late
+ * stragglers) by event ID. Every part's fragments are counted against the completeness model;
+ * once every required subsystem has delivered, the event leaves the merger for the output queue,
+ * so the merger only ever holds events that are still waiting for data.
+ *
+ * The merger only sees assembled fragments, not their links, so a link-mask requirement counts as
+ * one fragment per link in the mask (CompletenessModel::fragments_needed).
+ *
+ * Event IDs are spread over a power-of-two number of shards by the high bits of their hash. Each
+ * shard has its own lock, an open-addressing EventIdTable from event ID to a slot in a pool of
+ * pending events, and a free list of pool slots, so merges of different events rarely contend and
+ * a waiting event costs no node allocation of its own.
+ *
+ * An event that is still waiting MergerConfig::timeout_ns after its first part arrived is sent on
+ * as incomplete by expire_stale(). Each shard keeps its deadlines in a min-heap; entries for events
+ * that completed in time are not removed but skipped when they reach the top, since their event is
+ * gone or carries a different deadline. Counters are atomics, so status reports take no locks, and
+nothing is logged per part: print_merged_status() gives the totals.
+ */
 class EventMerger {
 public:
+    EventMerger(const CompletenessModel& completeness, MergedEventQueue& output,
+                const MergerConfig& config = MergerConfig())
+        : m_completeness(completeness), m_output(output),
+          m_outstanding_when_empty(completeness.outstanding_when_empty()),
+          m_timeout_ns(config.timeout_ns) {
+        size_t count = 1;
+        while (count < config.shards) count <<= 1;
+        m_shard_bits = 0;
+        while ((size_t(1) << m_shard_bits) < count) ++m_shard_bits;
+        m_num_shards = count;
+        m_shards.reset(new Shard[count]);
+        size_t per_shard = config.expected_in_flight / count + 1;
+        for (size_t i = 0; i < count; ++i) {
+            m_shards[i].index = EventIdTable<uint32_t>(per_shard);
+        }
+    }
+
     // Function to receive and merge partial events
     void merge_event(PhysicsEventData&& partial_event) {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        unsigned int id = partial_event.event_id;
-
-        if (m_incomplete_events.find(id) == m_incomplete_events.end()) {
-            // First time seeing this Event ID, store it
-            m_incomplete_events[id] = std::move(partial_event);
-            std::cout << "[Merger] Stored first part of Event ID " << id << std::endl;
-        } else {
-            // Found existing parts, merge the new data in
-            PhysicsEventData& existing_event = m_incomplete_events[id];
-
-            // Merge systems_readout lists
-            existing_event.systems_readout.insert(
-                existing_event.systems_readout.end(),
-                partial_event.systems_readout.begin(),
-                partial_event.systems_readout.end()
-            );
-
-            // Merge Tracker frames
-            if (!partial_event.tracker_info.frames.empty()) {
-                existing_event.tracker_info.frames.insert(
-                    existing_event.tracker_info.frames.end(),
-                    std::make_move_iterator(partial_event.tracker_info.frames.begin()),
-                    std::make_move_iterator(partial_event.tracker_info.frames.end())
+        MergedEvent finished;
+        uint64_t id = static_cast<uint64_t>(partial_event.event_id);
+        Shard& shard = shard_of(id);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            uint32_t* slot = shard.index.find(id);
+            if (slot == nullptr) {
+                // First time seeing this Event ID
+                PendingEvent pending;
+                pending.outstanding = m_outstanding_when_empty;
+                count_fragments(pending, partial_event);
+                if (pending.outstanding == 0) {
+                    // Complete on arrival (the common case): never stored
+                    finished.event = std::move(partial_event);
+                } else {
+                    pending.event = std::move(partial_event);
+                    if (m_timeout_ns > 0) {
+                        pending.deadline_ns = now_ns() + m_timeout_ns;
+                        shard.deadlines.push(Deadline{pending.deadline_ns, id});
+                    }
+                    bool inserted = false;
+                    shard.index.find_or_insert(id, inserted) = shard.store(std::move(pending));
+                    shard.waiting.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+            } else {
+                // Found existing parts, merge the new data in
+                PendingEvent& pending = shard.pool[*slot];
+                PhysicsEventData& existing_event = pending.event;
+                count_fragments(pending, partial_event);
+
+                // Merge systems_readout lists
+                existing_event.systems_readout.insert(
+                    existing_event.systems_readout.end(),
+                    partial_event.systems_readout.begin(),
+                    partial_event.systems_readout.end()
                 );
+
+                // Merge frames; each subsystem's frames are one contiguous arena, so this is an append
+                existing_event.tracker_info.frames.append(std::move(partial_event.tracker_info.frames));
+                existing_event.hcal_info.frames.append(std::move(partial_event.hcal_info.frames));
+                existing_event.ecal_info.frames.append(std::move(partial_event.ecal_info.frames));
+
+                if (pending.outstanding != 0) return;
+                uint32_t done = *slot;
+                shard.index.erase(id);
+                finished.event = shard.release(done);
+                shard.waiting.fetch_sub(1, std::memory_order_relaxed);
             }
-            // Merge HCal frames
-            if (!partial_event.hcal_info.frames.empty()) {
-                existing_event.hcal_info.frames.insert(
-                    existing_event.hcal_info.frames.end(),
-                    std::make_move_iterator(partial_event.hcal_info.frames.begin()),
-                    std::make_move_iterator(partial_event.hcal_info.frames.end())
-                );
+            finished.complete = true;
+            shard.completed.fetch_add(1, std::memory_order_relaxed);
+        }
+        // Outside the lock: a full queue stalls this producer, not every merge
+        m_output.push(std::move(finished));
+    }
+
+    /*
+    Sends every event whose deadline has passed to the output as incomplete. Called periodically
+    by the builder; each shard's lock is held only while its expired entries are taken out.
+    */
+    size_t expire_stale(long long now = now_ns()) {
+        size_t expired = 0;
+        std::vector<PhysicsEventData> stale;
+        for (size_t i = 0; i < m_num_shards; ++i) {
+            Shard& shard = m_shards[i];
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                while (!shard.deadlines.empty() && shard.deadlines.top().expires_ns <= now) {
+                    Deadline deadline = shard.deadlines.top();
+                    shard.deadlines.pop();
+                    uint32_t* slot = shard.index.find(deadline.event_id);
+                    // Completed in time, or completed and started again under the same ID
+                    if (slot == nullptr || shard.pool[*slot].deadline_ns != deadline.expires_ns) continue;
+                    uint32_t done = *slot;
+                    shard.index.erase(deadline.event_id);
+                    stale.push_back(shard.release(done));
+                }
+                shard.waiting.fetch_sub(stale.size(), std::memory_order_relaxed);
+                shard.expired.fetch_add(stale.size(), std::memory_order_relaxed);
             }
-            // Merge ECal frames
-            if (!partial_event.ecal_info.frames.empty()) {
-                existing_event.ecal_info.frames.insert(
-                    existing_event.ecal_info.frames.end(),
-                    std::make_move_iterator(partial_event.ecal_info.frames.begin()),
-                    std::make_move_iterator(partial_event.ecal_info.frames.end())
-                );
+            for (auto& event : stale) {
+                std::cout << "[Merger] Event ID " << event.event_id << " timed out with "
+                          << event.systems_readout.size() << " fragments, sent on incomplete" << std::endl;
+                MergedEvent partial;
+                partial.event = std::move(event);
+                partial.complete = false;
+                m_output.push(std::move(partial));
             }
+            expired += stale.size();
+            stale.clear();
+        }
+        return expired;
+    }
 
-            std::cout << "[Merger] Merged new data into Event ID " << id << ". Total subsystems read: " << existing_event.systems_readout.size() << std::endl;
-
-            // TODO: Add logic here to check if the event is now fully complete (e.g., all 3 subsystems present)
-            // If complete, move it out of the map to a 'complete' queue for final writing to disk.
+    // End of run: hands every event still waiting for data to the output as incomplete
+    size_t flush_incomplete() {
+        size_t flushed = 0;
+        for (size_t i = 0; i < m_num_shards; ++i) {
+            Shard& shard = m_shards[i];
+            std::vector<PhysicsEventData> remaining;
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                shard.index.for_each([&](uint64_t, uint32_t slot) { remaining.push_back(shard.release(slot)); });
+                shard.index = EventIdTable<uint32_t>(shard.index.capacity() / 2);
+                shard.deadlines = DeadlineHeap();
+                shard.waiting.store(0, std::memory_order_relaxed);
+            }
+            for (auto& event : remaining) {
+                MergedEvent partial;
+                partial.event = std::move(event);
+                partial.complete = false;
+                m_output.push(std::move(partial));
+            }
+            flushed += remaining.size();
         }
+        return flushed;
     }
 
-    // A simple function to report final merged event sizes for demonstration
-    void print_merged_status() {
-        std::lock_guard<std::mutex> lock(m_mutex);
-        for (const auto& pair : m_incomplete_events) {
-            std::cout << "[Merger Status] Event ID " << pair.first << " is finalized with data from "
-                      << pair.second.systems_readout.size() << " subsystem fragments." << std::endl;
+    // Events currently waiting for more parts
+    size_t in_flight() const { return status().in_flight; }
+
+    size_t shard_count() const { return m_num_shards; }
+
+    // Sums the shards' counters without taking their locks, so it never stalls a merge
+    MergerStatus status() const {
+        MergerStatus total;
+        for (size_t i = 0; i < m_num_shards; ++i) {
+            const Shard& shard = m_shards[i];
+            total.in_flight += shard.waiting.load(std::memory_order_relaxed);
+            total.completed += shard.completed.load(std::memory_order_relaxed);
+            total.expired += shard.expired.load(std::memory_order_relaxed);
         }
+        return total;
+    }
+
+    // A simple function to report what the merger is still holding
+    void print_merged_status() const {
+        MergerStatus now = status();
+        std::cout << "[Merger Status] " << now.completed << " events completed, " << now.expired
+                  << " timed out, " << now.in_flight << " waiting for data in " << m_num_shards
+                  << " shards" << std::endl;
     }
 
 private:
-    std::map<unsigned int, PhysicsEventData> m_incomplete_events;
-    std::mutex m_mutex;
+    struct PendingEvent {
+        PhysicsEventData event;
+        std::array<unsigned int, CompletenessModel::kMaxSubsystems> fragments{};
+        unsigned int outstanding = 0; // required subsystems not yet satisfied
+        long long deadline_ns = 0;
+    };
+
+    struct Deadline {
+        long long expires_ns;
+        uint64_t event_id;
+        bool operator>(const Deadline& other) const { return expires_ns > other.expires_ns; }
+    };
+    using DeadlineHeap = std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>>;
+
+    // One lock's worth of events, on its own cache lines so shards don't false-share their locks
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        EventIdTable<uint32_t> index{16};  // event ID -> slot in pool
+        std::vector<PendingEvent> pool;    // recycled through free_slots
+        std::vector<uint32_t> free_slots;
+        DeadlineHeap deadlines;            // may hold entries for events that already left
+        std::atomic<size_t> waiting{0};
+        std::atomic<size_t> completed{0};
+        std::atomic<size_t> expired{0};
+
+        uint32_t store(PendingEvent&& pending) {
+            if (free_slots.empty()) {
+                pool.push_back(std::move(pending));
+                return static_cast<uint32_t>(pool.size() - 1);
+            }
+            uint32_t slot = free_slots.back();
+            free_slots.pop_back();
+            pool[slot] = std::move(pending);
+            return slot;
+        }
+
+        // Takes the event out of its slot and recycles the slot
+        PhysicsEventData release(uint32_t slot) {
+            PhysicsEventData event = std::move(pool[slot].event);
+            pool[slot] = PendingEvent();
+            free_slots.push_back(slot);
+            return event;
+        }
+    };
+
+    static long long now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    Shard& shard_of(uint64_t id) {
+        if (m_shard_bits == 0) return m_shards[0];
+        return m_shards[EventIdTable<uint32_t>::hash(id) >> (64 - m_shard_bits)];
+    }
+
+    void count_fragments(PendingEvent& pending, const PhysicsEventData& part) const {
+        for (uint64_t subsystem : part.systems_readout) {
+            int index = m_completeness.index_of(subsystem);
+            if (index < 0) continue;
+            unsigned int seen = ++pending.fragments[index];
+            if (m_completeness.is_required(index) && seen == m_completeness.fragments_needed(index)) {
+                --pending.outstanding;
+            }
+        }
+    }
+
+    const CompletenessModel& m_completeness;
+    MergedEventQueue& m_output;
+    const unsigned int m_outstanding_when_empty;
+    const long long m_timeout_ns;
+    std::unique_ptr<Shard[]> m_shards;
+    size_t m_num_shards = 1;
+    unsigned int m_shard_bits = 0;
 };
 #endif
@@ -0,0 +1,217 @@
+// EventSequencer.hh
+#ifndef EVENTSEQUENCER_H
+#define EVENTSEQUENCER_H
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <iostream>
+#include "EventMerger.hh"
+
+struct SequencerConfig {
+    size_t capacity = 0;                // reorder ring slots, 0 = write events in arrival order
+    long long max_hold_ns = 3000000000; // longest a missing event ID holds back the ones after it
+    uint64_t stride = 1;                // step between consecutive IDs of this stream (N on a farm of N nodes)
+};
+
+// Event IDs first..last (inclusive, in steps of the stride) that were given up on
+struct SequenceGap {
+    uint64_t first;
+    uint64_t last;
+};
+
+/**
+ * Puts merged events back into event-ID order before they are written.
+ *
+ * Events wait in a ring of capacity slots indexed by (event_id / stride) % capacity, so the ring
+ * covers the next capacity IDs after the oldest one not yet emitted. An event is emitted as soon as
+ * every ID before it has been. A missing ID is skipped (and recorded as a gap) when it has held the
+ * ring back for max_hold_ns, or when an event arrives too far ahead to fit in the ring. An event
+ * whose ID was already skipped is emitted straight away, out of order, and counted as late.
+ *
+ * Where the stream starts is not known in advance, so nothing leaves during the first hold time
+ * (or until the ring overflows): the head is then the lowest ID seen so far.
+ *
+ * Single-threaded: the writer thread feeds it. Events leave through the emit callback.
+ */
+class EventSequencer {
+public:
+    // Only the first kMaxRecordedGaps gaps are kept; skipped_ids() counts all of them
+    static constexpr size_t kMaxRecordedGaps = 4096;
+
+    explicit EventSequencer(const SequencerConfig& config)
+        : m_ring(config.capacity == 0 ? 1 : config.capacity),
+          m_stride(config.stride == 0 ? 1 : config.stride),
+          m_max_hold_ns(config.max_hold_ns) {}
+
+    template <typename Emit>
+    void push(MergedEvent&& merged, long long now_ns, Emit&& emit) {
+        uint64_t id = static_cast<uint64_t>(merged.event.event_id);
+        uint64_t window = (m_ring.size() - 1) * m_stride;
+        if (!m_started) {
+            m_started = true;
+            m_next = id;
+            m_highest = id;
+        }
+        // While warming up, the head can still move down to an earlier ID that fits
+        if (id < m_next && m_warming_up && m_highest - id <= window) {
+            m_next = id;
+        }
+        if (id > m_highest) m_highest = id;
+        if (id < m_next) {
+            ++m_late;
+            emit(std::move(merged));
+            return;
+        }
+        // Too far ahead: move the window up, giving up on whatever has not arrived below it
+        if (id - m_next > window) {
+            advance_to(id - window, emit);
+        }
+        Slot& slot = m_ring[index(id)];
+        if (slot.full) {
+            // Same slot, different stream position: only a repeated ID or a misrouted event gets here
+            ++m_late;
+            emit(std::move(merged));
+            return;
+        }
+        slot.event = std::move(merged);
+        slot.full = true;
+        ++m_held;
+        drain(now_ns, emit);
+    }
+
+    // Skips the missing ID at the head once it has held the ring back for max_hold_ns
+    template <typename Emit>
+    void expire(long long now_ns, Emit&& emit) {
+        while (m_blocked && now_ns - m_blocked_since >= m_max_hold_ns) {
+            if (m_warming_up) m_warming_up = false;
+            else skip_gap();
+            drain(now_ns, emit);
+        }
+    }
+
+    // End of run: emits everything still held, in order, skipping the gaps between
+    template <typename Emit>
+    void flush(Emit&& emit) {
+        m_warming_up = false;
+        drain(0, emit);
+        while (m_held != 0) {
+            skip_gap();
+            drain(0, emit);
+        }
+    }
+
+    size_t held() const { return m_held; }
+    size_t emitted_in_order() const { return m_in_order; }
+    size_t late() const { return m_late; }
+    uint64_t skipped_ids() const { return m_skipped; }
+    const std::vector<SequenceGap>& gaps() const { return m_gaps; }
+
+    void print_summary() const {
+        std::cout << "[Sequencer] " << m_in_order << " events in order, " << m_late << " late, "
+                  << m_skipped << " event IDs skipped in " << m_gap_count << " gaps" << std::endl;
+    }
+
+private:
+    struct Slot {
+        MergedEvent event;
+        bool full = false;
+    };
+
+    size_t index(uint64_t id) const { return (id / m_stride) % m_ring.size(); }
+
+    // Emits the run of held events starting at the next ID
+    template <typename Emit>
+    void drain(long long now_ns, Emit&& emit) {
+        bool advanced = false;
+        while (m_held != 0 && !m_warming_up) {
+            Slot& slot = m_ring[index(m_next)];
+            if (!slot.full || static_cast<uint64_t>(slot.event.event.event_id) != m_next) break;
+            emit_slot(slot, emit);
+            m_next += m_stride;
+            advanced = true;
+        }
+        // A new hole at the head starts its own hold time
+        if (m_held != 0 && (advanced || !m_blocked)) {
+            m_blocked_since = now_ns;
+            m_blocked = true;
+        }
+        if (m_held == 0) m_blocked = false;
+    }
+
+    // Gives up on the missing IDs between the head and the first held event
+    void skip_gap() {
+        if (m_ring[index(m_next)].full) return;
+        uint64_t first = m_next;
+        while (!m_ring[index(m_next)].full) m_next += m_stride;
+        uint64_t last = m_next - m_stride;
+        record_gap(first, last);
+        std::cout << "[Sequencer] Gave up waiting for event ID " << first;
+        if (last != first) std::cout << " to " << last;
+        std::cout << std::endl;
+    }
+
+    // Moves the head up to target, emitting held events on the way and recording the missing IDs
+    template <typename Emit>
+    void advance_to(uint64_t target, Emit&& emit) {
+        uint64_t skipped_before = m_skipped;
+        m_warming_up = false;
+        while (m_next < target) {
+            if (m_held == 0) {
+                // Nothing held: jump straight there instead of stepping over every ID
+                uint64_t steps = (target - m_next + m_stride - 1) / m_stride;
+                record_gap(m_next, m_next + (steps - 1) * m_stride);
+                m_next += steps * m_stride;
+                break;
+            }
+            Slot& slot = m_ring[index(m_next)];
+            if (slot.full && static_cast<uint64_t>(slot.event.event.event_id) == m_next) {
+                emit_slot(slot, emit);
+            } else {
+                record_gap(m_next, m_next);
+            }
+            m_next += m_stride;
+        }
+        m_blocked = false;
+        std::cout << "[Sequencer] Reorder window moved up to event ID " << m_next << ", skipping "
+                  << (m_skipped - skipped_before) << " missing event IDs" << std::endl;
+    }
+
+    template <typename Emit>
+    void emit_slot(Slot& slot, Emit&& emit) {
+        emit(std::move(slot.event));
+        slot.event = MergedEvent();
+        slot.full = false;
+        --m_held;
+        ++m_in_order;
+    }
+
+    // Adjacent skips (one ID at a time while advancing) are folded into one gap
+    void record_gap(uint64_t first, uint64_t last) {
+        m_skipped += (last - first) / m_stride + 1;
+        bool latest_recorded = m_gaps.size() == m_gap_count;
+        if (latest_recorded && !m_gaps.empty() && m_gaps.back().last + m_stride == first) {
+            m_gaps.back().last = last;
+            return;
+        }
+        ++m_gap_count;
+        if (m_gaps.size() < kMaxRecordedGaps) m_gaps.push_back(SequenceGap{first, last});
+    }
+
+    std::vector<Slot> m_ring;
+    const uint64_t m_stride;
+    const long long m_max_hold_ns;
+    bool m_started = false;
+    bool m_warming_up = true;     // head not settled yet, nothing emitted
+    uint64_t m_next = 0;          // oldest ID not yet emitted or skipped
+    uint64_t m_highest = 0;       // highest ID seen
+    size_t m_held = 0;
+    bool m_blocked = false;       // events are held behind a missing ID
+    long long m_blocked_since = 0;
+    size_t m_in_order = 0;
+    size_t m_late = 0;
+    uint64_t m_skipped = 0;
+    size_t m_gap_count = 0;
+    std::vector<SequenceGap> m_gaps; // the first kMaxRecordedGaps of them
+};
+#endif
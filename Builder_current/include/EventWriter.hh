@@ -0,0 +1,136 @@
+// EventWriter.hh
+#ifndef EVENTWRITER_H
+#define EVENTWRITER_H
+#pragma once
+#include <string>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include "EventMerger.hh"
+#include "EventCodec.hh"
+#include "EventSequencer.hh"
+
+/**
+ * Final stage of the builder: a thread that takes merged events off the merger's output queue and
+ * writes them out, releasing each event (and its arena) as soon as it is on disk. With no output
+ * file the events are only counted.
+ *
+ * Each event is one record: a native-order uint32 of flags (bit 0: complete) followed by the
+ * event in the event_codec form (EventCodec.hh).
+ *
+ * With a sequencer configured, events go through an EventSequencer first and are written in
+ * event-ID order; the thread then wakes at least every 10 ms to give up on IDs held too long.
+ *
+ * If a write fails (disk full, I/O error) the file is closed and nothing more is written, but the
+ * thread keeps taking events off the queue, so the merger never blocks on a dead writer;
+ * output_failed() then reports it.
+ */
+class EventWriter {
+public:
+    static constexpr uint32_t kFlagComplete = 1;
+
+    EventWriter(MergedEventQueue& input, const std::string& output_path,
+                const SequencerConfig& sequencing = SequencerConfig())
+        : m_input(input) {
+        if (sequencing.capacity != 0) m_sequencer = std::make_unique<EventSequencer>(sequencing);
+        if (!output_path.empty()) {
+            m_file.open(output_path, std::ios::binary | std::ios::trunc);
+            if (!m_file.is_open()) {
+                throw std::runtime_error("Could not open event output file: " + output_path);
+            }
+        }
+    }
+
+    EventWriter(const EventWriter&) = delete;
+    EventWriter& operator=(const EventWriter&) = delete;
+
+    ~EventWriter() { join(); }
+
+    void start() {
+        m_thread = std::thread([this]() { run(); });
+    }
+
+    // Returns once the queue has been closed and everything in it written
+    void join() {
+        if (m_thread.joinable()) m_thread.join();
+    }
+
+    size_t complete_events() const { return m_complete; }
+    size_t partial_events() const { return m_partial; }
+    uint64_t bytes_written() const { return m_bytes; }
+
+    // Only read it once the writer has been joined
+    bool output_failed() const { return m_failed; }
+
+    // Null unless sequencing was configured; only read it once the writer has been joined
+    const EventSequencer* sequencer() const { return m_sequencer.get(); }
+
+    // Appends the record for merged to out
+    static void encode_record(const MergedEvent& merged, std::vector<char>& out) {
+        event_codec::put<uint32_t>(out, merged.complete ? kFlagComplete : 0);
+        event_codec::encode(merged.event, out);
+    }
+
+private:
+    void run() {
+        auto write = [this](MergedEvent&& merged) {
+            if (merged.complete) ++m_complete;
+            else ++m_partial;
+            if (m_file.is_open()) {
+                m_record.clear();
+                encode_record(merged, m_record);
+                m_file.write(m_record.data(), m_record.size());
+                if (m_file) {
+                    m_bytes += m_record.size();
+                } else {
+                    fail("writing event ID " + std::to_string(merged.event.event_id));
+                }
+            }
+            std::cout << "[Writer] Event ID " << merged.event.event_id
+                      << (merged.complete ? " complete" : " INCOMPLETE") << ", "
+                      << merged.event.systems_readout.size() << " fragments" << std::endl;
+        };
+
+        MergedEvent merged;
+        if (!m_sequencer) {
+            while (m_input.pop(merged)) {
+                write(std::move(merged));
+                merged = MergedEvent(); // release the event's memory now, not when the next one arrives
+            }
+        } else {
+            while (!m_input.finished()) {
+                bool popped = m_input.pop_for(merged, std::chrono::milliseconds(10));
+                long long now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+                if (popped) m_sequencer->push(std::move(merged), now, write);
+                m_sequencer->expire(now, write);
+                merged = MergedEvent();
+            }
+            m_sequencer->flush(write);
+        }
+        if (m_file.is_open() && !m_file.flush()) fail("flushing the output");
+    }
+
+    void fail(const std::string& what) {
+        std::cerr << "[Writer] Output failed while " << what << " after " << m_bytes
+                  << " bytes; no further events are written" << std::endl;
+        m_file.close();
+        m_failed = true;
+    }
+
+    MergedEventQueue& m_input;
+    std::ofstream m_file;
+    std::vector<char> m_record; // reused for every record
+    std::unique_ptr<EventSequencer> m_sequencer;
+    std::thread m_thread;
+    size_t m_complete = 0;
+    size_t m_partial = 0;
+    uint64_t m_bytes = 0;
+    bool m_failed = false;
+};
+#endif
@@ -42,6 +42,9 @@ struct FragmentHeader {
 
     // Header Word 1
     uint64_t timestamp;
+
+    // Header Word 2
+    uint64_t event_id;              // Trigger event ID / pulseId, used for event-ID matching
 };
 
 // Represents a single data fragment
@@ -49,6 +52,7 @@ struct DataFragment {
     FragmentHeader header;
     std::vector<char> payload; // Raw byte data from the readout
     FragmentTrailer trailer;
+    int64_t clock_correction_ns = 0; // Subtracted from header.timestamp at ingest by ClockCalibration
 };
 
 #endif
@@ -6,16 +6,211 @@
 #include <vector>
 #include <mutex>
 #include <chrono>
+#include <condition_variable>
 #include "Fragment.hh"
+#include "EventCompleteness.hh"
+#include "EventIdTable.hh"
+#include "IngestQueue.hh"
+#include "SpillStore.hh"
+#include "WindowTuner.hh"
+#include "ClockCalibration.hh"
+#include "LateFragmentIndex.hh"
+#include <memory>
+#include <array>
+#include <limits>
+#include <atomic>
 #include <set>
+#include <deque>
+#include <cstdlib>
+#include <iostream>
+
+// How fragments are grouped into events
+enum class MatchMode {
+    TimeWindow,   // group by header.timestamp within +/- coherence_window_ns
+    EventId       // group by header.event_id (trigger event ID / pulseId), timestamps only cross-checked
+};
+
+/*
+Memory bounds for the buffer. A limit of 0 disables it.
+
+soft_limit_bytes: once the in-memory bytes exceed this, the payloads of the oldest windows (or
+                  oldest event IDs) are spilled to spill_path and reloaded when the event is built.
+                  Headers stay in memory so completeness checks are unaffected. If the spill file
+                  fails (disk full, I/O error) spilling stops and the soft limit is enforced by the
+                  drop policy below instead.
+hard_limit_bytes: once in-memory plus spilled bytes exceed this, the drop policy applies: the
+                  oldest window / event ID is discarded whole. It is the one furthest past its
+                  timeout, so at best it would only have produced a partial event.
+*/
+struct MemoryLimits {
+    size_t soft_limit_bytes = 0;
+    size_t hard_limit_bytes = 0;
+    std::string spill_path;
+};
+
+// Snapshot of the buffer's byte accounting. Cumulative counters can be differenced for rates.
+struct BufferMetrics {
+    uint64_t memory_bytes = 0;        // fragment headers + in-memory payloads
+    uint64_t spilled_bytes = 0;       // payload bytes currently in the spill file
+    uint64_t spilled_total = 0;       // cumulative bytes written to the spill file
+    uint64_t reloaded_total = 0;      // cumulative bytes read back from it
+    uint64_t dropped_fragments = 0;
+    uint64_t dropped_bytes = 0;
+    uint64_t late_fragments = 0;      // stragglers routed to the merger after a forced build
+    uint64_t spill_failures = 0;      // failed spill writes/reads; a failed read drops its fragment
+    std::map<uint64_t, uint64_t> memory_by_subsystem;
+    std::map<uint64_t, uint64_t> spilled_by_subsystem;
+};
+
+// A fragment that arrived after its event was force-built, tagged with that event's ID
+struct LateFragment {
+    uint64_t event_id;
+    DataFragment fragment;
+};
 
 class FragmentBuffer {
 public:
     using Timestamp = long long;
 
+    explicit FragmentBuffer(CompletenessModel model = CompletenessModel::default_model(),
+                            size_t ingest_capacity = 1 << 14)
+        : m_ingest(ingest_capacity), m_completeness(std::move(model)) {}
+
+    /*
+    Switches the buffer to event-ID matching. Must be called before fragments arrive.
+    expected_in_flight pre-sizes the hash table; timestamp_tolerance_ns is the largest spread of
+    fragment timestamps within one event ID before it is counted as a mismatch.
+    */
+    void use_event_id_matching(size_t expected_in_flight, long long timestamp_tolerance_ns) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_mode = MatchMode::EventId;
+        m_pending = EventIdTable<uint32_t>(expected_in_flight);
+        m_timestamp_tolerance_ns = timestamp_tolerance_ns;
+    }
+
+    MatchMode match_mode() const { return m_mode; }
+
+    // Must be called before fragments arrive
+    void set_memory_limits(const MemoryLimits& limits) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_limits = limits;
+        if (m_limits.soft_limit_bytes != 0 && !m_limits.spill_path.empty()) {
+            m_spill.open(m_limits.spill_path);
+        }
+    }
+
+    /*
+    Lets the buffer learn the coherence window and latency delay from the timestamp spread of
+    complete events, within the bounds in config. initial is used until the first re-tune.
+    */
+    void enable_window_tuning(const WindowTuningConfig& config, WindowSettings initial) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tuner = std::make_unique<WindowTuner>(config, initial);
+    }
+
+    // The tuned window/latency if tuning is enabled, otherwise fallback
+    WindowSettings window_settings(WindowSettings fallback) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_tuner ? m_tuner->settings() : fallback;
+    }
+
+    /*
+    Learns per-subsystem (or per-link) clock offset and drift from complete events and removes
+    them from timestamps at ingest, before fragments are bucketed. The starting window must be wide
+    enough for the uncorrected offsets, otherwise no events complete and nothing is learned.
+    */
+    void enable_clock_calibration(const ClockCalibrationConfig& config) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_calibration = std::make_unique<ClockCalibration>(config);
+    }
+
+    /*
+    Remembers the last capacity force-built events. A fragment that lands in one of their windows
+    (or carries one of their event IDs) afterwards is set aside for take_late_fragments() instead
+    of starting a bogus one-subsystem window.
+    */
+    void enable_late_fragment_index(size_t capacity) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_late_index = std::make_unique<LateFragmentIndex>(capacity);
+    }
+
+    // Hands over stragglers so the caller can merge them into their already-built events
+    size_t take_late_fragments(std::vector<LateFragment>& out) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t n = m_late.size();
+        for (auto& late : m_late) {
+            out.push_back(std::move(late));
+        }
+        m_late.clear();
+        return n;
+    }
+
+    void print_clock_calibration() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_calibration) m_calibration->print();
+    }
+
+    void print_window_tuning() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_tuner) m_tuner->print();
+    }
+
+    BufferMetrics metrics() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        BufferMetrics snapshot = m_metrics;
+        for (size_t id = 0; id < m_memory_by_subsystem.size(); ++id) {
+            if (m_memory_by_subsystem[id] != 0) snapshot.memory_by_subsystem[id] = m_memory_by_subsystem[id];
+            if (m_spilled_by_subsystem[id] != 0) snapshot.spilled_by_subsystem[id] = m_spilled_by_subsystem[id];
+        }
+        return snapshot;
+    }
+
+    // Direct, locked insert. Listener threads should prefer submit(), which never takes m_mutex.
     void add_fragment(DataFragment&& fragment) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            insert_locked(std::move(fragment));
+            enforce_memory_limits_locked();
+        }
+        signal_arrival();
+    }
+
+    /*
+    Lock-free ingest for receive threads: the fragment goes into a bounded MPSC queue and is
+    moved into the buffer later by the owning (builder) thread via drain_ingest(). Returns false
+    if the queue is full, in which case the fragment is left untouched for the caller to retry.
+    */
+    bool submit(DataFragment&& fragment) {
+        if (!m_ingest.try_push(std::move(fragment))) return false;
+        signal_arrival();
+        return true;
+    }
+
+    /*
+    Moves queued fragments into the buffer under one lock hold. Only the buffer-owning thread
+    may call this (it is the single consumer of the ingest queue).
+    */
+    size_t drain_ingest(size_t max_fragments = 4096) {
+        m_drain_scratch.clear();
+        m_ingest.drain([&](DataFragment&& frag) { m_drain_scratch.push_back(std::move(frag)); }, max_fragments);
+        if (m_drain_scratch.empty()) return 0;
         std::lock_guard<std::mutex> lock(m_mutex);
-        m_fragments[fragment.header.timestamp].push_back(std::move(fragment));
+        for (auto& frag : m_drain_scratch) {
+            insert_locked(std::move(frag));
+        }
+        enforce_memory_limits_locked();
+        return m_drain_scratch.size();
+    }
+
+    /*
+    Blocks the builder until a new fragment arrives or the timeout passes.
+    Used instead of a fixed sleep so a window can be built as soon as its last expected fragment lands.
+    Producers signal without taking m_mutex, so a wakeup can occasionally be missed; the timeout bounds that.
+    */
+    void wait_for_fragment(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_arrival.wait_for(lock, timeout, [&] { return m_arrival_count.load(std::memory_order_acquire) != m_seen_arrivals; });
+        m_seen_arrivals = m_arrival_count.load(std::memory_order_acquire);
     }
 
     bool has_expired_fragments(Timestamp reference_time, long long coherence_window_ns) {
@@ -25,6 +220,238 @@ public:
         This helps the main event-building loop decide when to force the assembly of a partial event.
         */
         std::lock_guard<std::mutex> lock(m_mutex); // Prevents race conditions
+        return has_expired_locked(reference_time, coherence_window_ns);
+    }
+
+    /*
+    This is the primary function for assembling event fragments into events. Under a single lock
+    hold it extracts up to max_events events into built_events[0..n) and returns n. It has two
+    modes of operation, controlled by the force_assemble flag:
+      - false: every complete event, wherever it sits; an incomplete oldest window does not hold
+        back complete ones behind it.
+      - true: only expired windows (what has_expired_fragments would report), oldest first. A
+        complete window is never taken here, so it is never reported as a timeout; the pass stops
+        at it and the next non-forced pass picks it up.
+
+    built_events is owned by the caller and is never shrunk; the first n entries are cleared and
+    refilled, so both the outer vector and each fragment list keep their capacity between calls.
+    */
+    size_t try_build_events(Timestamp reference_time, long long coherence_window_ns,
+                            std::vector<std::vector<DataFragment>>& built_events, size_t max_events,
+                            bool force_assemble = false) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!force_assemble && m_mode == MatchMode::TimeWindow) {
+            return build_complete_windows_locked(coherence_window_ns, built_events, max_events);
+        }
+        size_t n = 0;
+        while (n < max_events) {
+            if (force_assemble && !has_expired_locked(reference_time, coherence_window_ns)) break;
+            if (n == built_events.size()) built_events.emplace_back();
+            std::vector<DataFragment>& slot = built_events[n];
+            slot.clear();
+            if (!build_one_locked(coherence_window_ns, slot, force_assemble)) break;
+            if (slot.empty()) continue;   // every payload was lost to a failed spill reload
+            ++n;
+        }
+        return n;
+    }
+
+    const CompletenessModel& completeness() const { return m_completeness; }
+
+    // Fragments whose timestamp disagreed with the rest of their event ID by more than the tolerance
+    size_t timestamp_mismatches() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_timestamp_mismatches;
+    }
+
+private:
+    /*
+    Fragments grouped under one timestamp (window mode) or one event ID. The first spilled.size()
+    fragments have had their payload moved to the spill file; their headers stay in memory.
+    */
+    struct FragmentGroup {
+        std::vector<DataFragment> fragments;
+        std::vector<SpillRef> spilled;
+
+        bool fully_spilled() const { return spilled.size() == fragments.size(); }
+    };
+
+    void insert_locked(DataFragment&& fragment) {
+        if (m_calibration) m_calibration->correct(fragment);
+        if (m_late_index && route_if_late(fragment)) return;
+        account_add(fragment);
+        if (m_mode == MatchMode::EventId) {
+            attach_by_event_id(std::move(fragment));
+        } else {
+            Timestamp ts = fragment.header.timestamp;
+            // Everything before the watermark is spilled; a group landing there needs a new look
+            if (ts < m_spill_watermark) m_spill_watermark = ts;
+            m_fragments[ts].fragments.push_back(std::move(fragment));
+        }
+    }
+
+    bool route_if_late(DataFragment& fragment) {
+        uint64_t event_id = fragment.header.event_id;
+        bool late = (m_mode == MatchMode::EventId)
+            ? m_late_index->contains_id(event_id)
+            : m_late_index->find_by_time(static_cast<Timestamp>(fragment.header.timestamp), event_id);
+        if (!late) return false;
+        ++m_metrics.late_fragments;
+        m_late.push_back(LateFragment{event_id, std::move(fragment)});
+        return true;
+    }
+
+    // --- byte accounting -------------------------------------------------------------------
+
+    static uint64_t header_bytes() { return sizeof(DataFragment); }
+
+    void account_add(const DataFragment& frag) {
+        uint64_t bytes = header_bytes() + frag.payload.size();
+        m_metrics.memory_bytes += bytes;
+        m_memory_by_subsystem[frag.header.subsystem_id] += bytes;
+    }
+
+    // Moves a group's fragments out of the buffer, reloading any spilled payloads
+    void release_group(FragmentGroup& group, std::vector<DataFragment>& out) {
+        for (size_t i = 0; i < group.fragments.size(); ++i) {
+            DataFragment& frag = group.fragments[i];
+            const uint64_t sub = frag.header.subsystem_id;
+            if (i < group.spilled.size()) {
+                const SpillRef& ref = group.spilled[i];
+                bool reloaded = m_spill.reload(ref, frag.payload);
+                m_metrics.spilled_bytes -= ref.size;
+                m_spilled_by_subsystem[sub] -= ref.size;
+                m_metrics.memory_bytes -= header_bytes();
+                m_memory_by_subsystem[sub] -= header_bytes();
+                if (!reloaded) {
+                    // The payload is gone; the event is built without this fragment
+                    note_spill_failure();
+                    ++m_metrics.dropped_fragments;
+                    m_metrics.dropped_bytes += header_bytes() + ref.size;
+                    continue;
+                }
+                m_metrics.reloaded_total += ref.size;
+            } else {
+                uint64_t bytes = header_bytes() + frag.payload.size();
+                m_metrics.memory_bytes -= bytes;
+                m_memory_by_subsystem[sub] -= bytes;
+            }
+            out.push_back(std::move(frag));
+        }
+        group.fragments.clear();
+        group.spilled.clear();
+    }
+
+    // False if the spill file failed; the fragments spilled so far stay spilled, the rest in memory
+    bool spill_group(FragmentGroup& group) {
+        for (size_t i = group.spilled.size(); i < group.fragments.size(); ++i) {
+            DataFragment& frag = group.fragments[i];
+            const uint64_t sub = frag.header.subsystem_id;
+            SpillRef ref;
+            if (!m_spill.append(frag.payload, ref)) {
+                note_spill_failure();
+                return false;
+            }
+            group.spilled.push_back(ref);
+            std::vector<char>().swap(frag.payload);
+            m_metrics.memory_bytes -= ref.size;
+            m_memory_by_subsystem[sub] -= ref.size;
+            m_metrics.spilled_bytes += ref.size;
+            m_metrics.spilled_total += ref.size;
+            m_spilled_by_subsystem[sub] += ref.size;
+        }
+        return true;
+    }
+
+    // Counts a spill file failure; only the first, which stops spilling, is logged
+    void note_spill_failure() {
+        if (m_metrics.spill_failures++ == 0) {
+            std::cerr << "[FragmentBuffer] " << m_spill.error() << "; spilling stopped, soft limit now drops" << std::endl;
+        }
+    }
+
+    void drop_group(FragmentGroup& group) {
+        for (size_t i = 0; i < group.fragments.size(); ++i) {
+            const DataFragment& frag = group.fragments[i];
+            const uint64_t sub = frag.header.subsystem_id;
+            uint64_t bytes = header_bytes();
+            if (i < group.spilled.size()) {
+                const SpillRef& ref = group.spilled[i];
+                m_spill.release(ref);
+                m_metrics.spilled_bytes -= ref.size;
+                m_spilled_by_subsystem[sub] -= ref.size;
+                m_metrics.dropped_bytes += ref.size;
+            } else {
+                bytes += frag.payload.size();
+            }
+            m_metrics.memory_bytes -= bytes;
+            m_memory_by_subsystem[sub] -= bytes;
+            m_metrics.dropped_bytes += bytes;
+            ++m_metrics.dropped_fragments;
+        }
+        group.fragments.clear();
+        group.spilled.clear();
+    }
+
+    void enforce_memory_limits_locked() {
+        if (m_limits.hard_limit_bytes != 0) {
+            while (m_metrics.memory_bytes + m_metrics.spilled_bytes > m_limits.hard_limit_bytes && drop_oldest_group()) {}
+        }
+        if (m_limits.soft_limit_bytes != 0 && m_spill.is_open()) {
+            while (m_metrics.memory_bytes > m_limits.soft_limit_bytes && !m_spill.failed() && spill_next_group()) {}
+            // Without a working spill file the soft limit falls back to the drop policy
+            if (m_spill.failed()) {
+                while (m_metrics.memory_bytes > m_limits.soft_limit_bytes && drop_oldest_group()) {}
+            }
+        }
+    }
+
+    // Spills the oldest group that still has payloads in memory. False if there is none.
+    bool spill_next_group() {
+        if (m_mode == MatchMode::EventId) {
+            for (; m_spill_arrival_index < m_arrivals.size(); ++m_spill_arrival_index) {
+                const Arrival& arrival = m_arrivals[m_spill_arrival_index];
+                PendingEvent* event = find_pending(arrival.event_id);
+                if (!event || event->first_timestamp != arrival.timestamp || event->group.fully_spilled()) continue;
+                return spill_group(event->group);
+            }
+            return false;
+        }
+        for (auto it = m_fragments.lower_bound(m_spill_watermark); it != m_fragments.end(); ++it) {
+            if (it->second.fully_spilled()) continue;
+            if (!spill_group(it->second)) return false;
+            m_spill_watermark = it->first;
+            return true;
+        }
+        return false;
+    }
+
+    bool drop_oldest_group() {
+        if (m_mode == MatchMode::EventId) {
+            const Arrival* oldest = oldest_pending();
+            if (!oldest) return false;
+            PendingEvent event;
+            take_pending_event(oldest->event_id, event);
+            pop_arrival();
+            drop_group(event.group);
+            return true;
+        }
+        if (m_fragments.empty()) return false;
+        drop_group(m_fragments.begin()->second);
+        m_fragments.erase(m_fragments.begin());
+        return true;
+    }
+
+    void signal_arrival() {
+        m_arrival_count.fetch_add(1, std::memory_order_release);
+        m_arrival.notify_one();
+    }
+
+    bool has_expired_locked(Timestamp reference_time, long long coherence_window_ns) {
+        if (m_mode == MatchMode::EventId) {
+            const Arrival* oldest = oldest_pending();
+            return oldest && oldest->timestamp < reference_time - coherence_window_ns;
+        }
         if (m_fragments.empty()) { // if no fragements return false
             return false;
         }
@@ -32,56 +459,252 @@ public:
         return it_oldest->first < reference_time - coherence_window_ns; // if the oldest fragment arrived before this threshold, it means the event is stale and should be considered expired
     }
 
-    bool try_build_event(Timestamp reference_time, long long coherence_window_ns, std::vector<DataFragment>& built_fragments, bool force_assemble = false) {
-        /*
-        This is the primary function for assembling event fragments into a single event.
-        It has two modes of operation, controlled by the force_assemble flag:
-        assembling complete events or forcing the assembly of incomplete, timed-out events.
+    // One event's fragments: per subsystem, how many fragments and which links (contributor_id) arrived
+    bool window_complete(std::map<Timestamp, FragmentGroup>::iterator it_begin,
+                         std::map<Timestamp, FragmentGroup>::iterator it_end) const {
+        CompletenessModel::Tallies tallies;
+        for (auto it = it_begin; it != it_end; ++it) {
+            for (const auto& frag : it->second.fragments) {
+                tallies[frag.header.subsystem_id].add(frag.header.contributor_id);
+            }
+        }
+        return m_completeness.is_complete(tallies);
+    }
 
-        */
-        std::lock_guard<std::mutex> lock(m_mutex); // Prevents race
+    /*
+    Time-window mode, non-forced: walks the buffered windows oldest first and takes every complete
+    one. Each window is anchored on its oldest fragment and spans [anchor, anchor + window]; the
+    next window starts at the first fragment after it, so windows never overlap. A complete window
+    is emitted as soon as the completeness model is satisfied rather than waiting for
+    reference_time (now - latency) to catch up with it, and incomplete windows are skipped over.
+    */
+    size_t build_complete_windows_locked(long long coherence_window_ns,
+                                         std::vector<std::vector<DataFragment>>& built_events, size_t max_events) {
+        size_t n = 0;
+        auto it = m_fragments.begin();
+        while (it != m_fragments.end() && n < max_events) {
+            auto it_end = m_fragments.upper_bound(it->first + coherence_window_ns);
+            if (!window_complete(it, it_end)) {
+                it = it_end;
+                continue;
+            }
+            if (n == built_events.size()) built_events.emplace_back();
+            std::vector<DataFragment>& slot = built_events[n];
+            slot.clear();
+            for (auto group = it; group != it_end; ++group) {
+                release_group(group->second, slot);
+            }
+            it = m_fragments.erase(it, it_end);
+            if (slot.empty()) continue;   // every payload was lost to a failed spill reload
+            observe_complete(slot, 0);
+            ++n;
+        }
+        return n;
+    }
+
+    // Forced build of the oldest expired window or event; false if there is none or it is complete
+    bool build_one_locked(long long coherence_window_ns, std::vector<DataFragment>& built_fragments, bool force_assemble) {
+        if (m_mode == MatchMode::EventId) {
+            return force_assemble ? take_oldest_pending(built_fragments) : take_ready(built_fragments);
+        }
 
         if (m_fragments.empty()) return false; // returns if not fragments
 
-        // Use the oldest fragment as the anchor for the time window if forcing assembly
-        Timestamp window_ref_time = force_assemble ? m_fragments.begin()->first : reference_time;
+        // The oldest fragment anchors the window: it is the event that has been waiting longest
+        Timestamp window_ref_time = m_fragments.begin()->first;
 
-        auto it_begin = m_fragments.lower_bound(window_ref_time - coherence_window_ns);
+        auto it_begin = m_fragments.begin();
         auto it_end = m_fragments.upper_bound(window_ref_time + coherence_window_ns);
 
-        if (it_begin == it_end) return false;
-
-        std::set<uint64_t> subsystems_found;
-        std::vector<Timestamp> timestamps_in_window;
+        // A complete window belongs to the non-forced pass, never to the timeout path
+        if (window_complete(it_begin, it_end)) return false;
 
+        size_t first = built_fragments.size();
         for (auto it = it_begin; it != it_end; ++it) {
-            timestamps_in_window.push_back(it->first);
-            /*
-            iterates through all fragments within the time window and populates a std::set with their subsystem_id
-            */
-            for (const auto& frag : it->second) {
-                subsystems_found.insert(frag.header.subsystem_id);
+            release_group(it->second, built_fragments);
+        }
+        m_fragments.erase(it_begin, it_end);
+        if (m_late_index && built_fragments.size() > first) {
+            // Anything landing in this window from now on is a straggler of this event
+            m_late_index->record(window_ref_time - coherence_window_ns, window_ref_time + coherence_window_ns,
+                                 built_fragments[first].header.event_id);
+        }
+        return true;
+    }
+
+    // Feeds a complete event's timestamps to the clock calibration and window tuner, if enabled
+    void observe_complete(const std::vector<DataFragment>& fragments, size_t first) {
+        if (first >= fragments.size()) return;
+        if (m_calibration) m_calibration->observe(fragments, first);
+        if (!m_tuner) return;
+        m_tuning_scratch.clear();
+        Timestamp anchor = static_cast<Timestamp>(fragments[first].header.timestamp);
+        for (size_t i = first; i < fragments.size(); ++i) {
+            Timestamp ts = static_cast<Timestamp>(fragments[i].header.timestamp);
+            anchor = std::min(anchor, ts);
+            m_tuning_scratch.emplace_back(fragments[i].header.subsystem_id, ts);
+        }
+        Timestamp now = std::chrono::time_point_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now()).time_since_epoch().count();
+        if (m_tuner->observe(m_tuning_scratch, anchor, now - anchor)) {
+            WindowSettings tuned = m_tuner->settings();
+            std::cout << "[FragmentBuffer] Re-tuned coherence window to " << tuned.coherence_window_ns
+                      << " ns, latency delay to " << tuned.latency_delay_ns << " ns" << std::endl;
+        }
+    }
+
+    // An event ID that has fragments but has not been built yet
+    struct PendingEvent {
+        FragmentGroup group;
+        CompletenessModel::TallyArray tallies{};
+        unsigned int outstanding = 0;   // required subsystems not yet satisfied
+        Timestamp first_timestamp = 0;
+        bool ready = false;
+    };
+
+    struct Arrival {
+        uint64_t event_id;
+        Timestamp timestamp;
+    };
+
+    // O(1) attach: one hash lookup plus an update of this subsystem's tally
+    void attach_by_event_id(DataFragment&& fragment) {
+        const uint64_t id = fragment.header.event_id;
+        const Timestamp ts = static_cast<Timestamp>(fragment.header.timestamp);
+
+        bool inserted;
+        uint32_t& slot = m_pending.find_or_insert(id, inserted);
+        if (inserted) slot = store_pending();
+        PendingEvent& event = m_pending_pool[slot];
+        if (inserted) {
+            event.outstanding = m_completeness.outstanding_when_empty();
+            event.first_timestamp = ts;
+            m_arrivals.push_back({id, ts});
+        } else if (std::llabs(ts - event.first_timestamp) > m_timestamp_tolerance_ns) {
+            ++m_timestamp_mismatches;   // reported by the builder's periodic status, not under this lock
+        }
+
+        int index = m_completeness.index_of(fragment.header.subsystem_id);
+        if (index >= 0) {
+            SubsystemTally& tally = event.tallies[index];
+            bool was_satisfied = m_completeness.is_satisfied(index, tally);
+            tally.add(fragment.header.contributor_id);
+            if (!was_satisfied && m_completeness.is_required(index) && m_completeness.is_satisfied(index, tally)) {
+                --event.outstanding;
             }
         }
+        // The spill scan has passed this event if it was spilled; send it back to the start
+        if (!inserted && !event.group.spilled.empty() && event.group.fully_spilled()) {
+            m_spill_arrival_index = 0;
+        }
+        event.group.fragments.push_back(std::move(fragment));
 
-        // The number of fragments from each subsystem is not constant.
-        // What we need is at least one fragment from each required subsystem. FIXME
-        if (!force_assemble && subsystems_found.size() < 3) { // Check for complete event (at least one from each) FIXME
-            return false;
+        if (!event.ready && event.outstanding == 0) {
+            event.ready = true;
+            m_ready.push_back(id);
         }
+    }
 
-        // Found a complete event or forcing assembly due to timeout
-        for (Timestamp ts : timestamps_in_window) {
-            for (auto& frag : m_fragments[ts]) {
-                built_fragments.push_back(std::move(frag));
+    bool take_ready(std::vector<DataFragment>& built_fragments) {
+        while (!m_ready.empty()) {
+            uint64_t id = m_ready.front();
+            m_ready.pop_front();
+            size_t first = built_fragments.size();
+            if (take_pending(id, built_fragments)) { // may already have been force-built
+                observe_complete(built_fragments, first);
+                return true;
             }
-            m_fragments.erase(ts);
         }
+        return false;
+    }
+
+    bool take_oldest_pending(std::vector<DataFragment>& built_fragments) {
+        const Arrival* oldest = oldest_pending();
+        if (!oldest) return false;
+        uint64_t id = oldest->event_id;
+        Timestamp ts = oldest->timestamp;
+        // Complete events leave through take_ready, never as timeouts
+        if (find_pending(id)->ready) return false;
+        pop_arrival();
+        if (!take_pending(id, built_fragments)) return false;
+        if (m_late_index) m_late_index->record(ts, ts, id);
         return true;
     }
 
-private:
-    std::map<Timestamp, std::vector<DataFragment>> m_fragments;
+    bool take_pending(uint64_t id, std::vector<DataFragment>& built_fragments) {
+        PendingEvent event;
+        if (!take_pending_event(id, event)) return false;
+        release_group(event.group, built_fragments);
+        return true;
+    }
+
+    PendingEvent* find_pending(uint64_t id) {
+        uint32_t* slot = m_pending.find(id);
+        return slot ? &m_pending_pool[*slot] : nullptr;
+    }
+
+    // A fresh pool slot for a new event ID, recycled from m_free_pending where possible
+    uint32_t store_pending() {
+        if (m_free_pending.empty()) {
+            m_pending_pool.emplace_back();
+            return static_cast<uint32_t>(m_pending_pool.size() - 1);
+        }
+        uint32_t slot = m_free_pending.back();
+        m_free_pending.pop_back();
+        return slot;
+    }
+
+    bool take_pending_event(uint64_t id, PendingEvent& out) {
+        uint32_t slot;
+        if (!m_pending.take(id, slot)) return false;
+        out = std::move(m_pending_pool[slot]);
+        m_pending_pool[slot] = PendingEvent();
+        m_free_pending.push_back(slot);
+        return true;
+    }
+
+    // Arrival order is kept lazily: entries for IDs that were already built are dropped here
+    const Arrival* oldest_pending() {
+        while (!m_arrivals.empty()) {
+            const Arrival& front = m_arrivals.front();
+            PendingEvent* event = find_pending(front.event_id);
+            if (event && event->first_timestamp == front.timestamp) return &front;
+            pop_arrival();
+        }
+        return nullptr;
+    }
+
+    void pop_arrival() {
+        m_arrivals.pop_front();
+        if (m_spill_arrival_index > 0) --m_spill_arrival_index;
+    }
+
+    MatchMode m_mode = MatchMode::TimeWindow;
+    std::map<Timestamp, FragmentGroup> m_fragments;
+    EventIdTable<uint32_t> m_pending{16};     // event ID -> slot in m_pending_pool
+    std::deque<PendingEvent> m_pending_pool;  // grows in chunks, so a larger pool never moves old events
+    std::vector<uint32_t> m_free_pending;
+    std::deque<uint64_t> m_ready;        // event IDs whose completeness was reached, in completion order
+    std::deque<Arrival> m_arrivals;      // event IDs in first-fragment order, for timeouts
+    long long m_timestamp_tolerance_ns = 0;
+    std::unique_ptr<WindowTuner> m_tuner;
+    std::unique_ptr<ClockCalibration> m_calibration;
+    std::unique_ptr<LateFragmentIndex> m_late_index;
+    std::vector<LateFragment> m_late;
+    std::vector<std::pair<uint64_t, long long>> m_tuning_scratch;
+    MemoryLimits m_limits;
+    SpillStore m_spill;
+    BufferMetrics m_metrics;   // totals only; per-subsystem bytes live in the arrays below
+    std::array<uint64_t, 256> m_memory_by_subsystem{};   // indexed by the 8-bit subsystem_id
+    std::array<uint64_t, 256> m_spilled_by_subsystem{};
+    Timestamp m_spill_watermark = std::numeric_limits<Timestamp>::min();     // window mode: groups before this are already spilled (lowered by insert_locked)
+    size_t m_spill_arrival_index = 0;     // event-ID mode: m_arrivals before this are already spilled
+    size_t m_timestamp_mismatches = 0;
+    IngestQueue<DataFragment> m_ingest;
+    std::vector<DataFragment> m_drain_scratch;   // owned by the draining thread, reused
+    std::atomic<uint64_t> m_arrival_count{0};
+    uint64_t m_seen_arrivals = 0;
+    CompletenessModel m_completeness;
     std::mutex m_mutex;
+    std::condition_variable m_arrival;
 };
 #endif // FRAGMENTBUFFER_H
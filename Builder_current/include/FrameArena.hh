@@ -0,0 +1,191 @@
+// FrameArena.hh
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+#pragma once
+#include <vector>
+#include <memory_resource>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "FrameView.hh"
+
+/*
+polymorphic_allocator whose argument-less construct() default-initialises, so resize() on a vector
+of words leaves them uninitialised instead of zeroing memory that is about to be overwritten.
+Copies of a container still get the default heap resource, like a std::pmr container.
+*/
+template <typename T>
+class DefaultInitAllocator : public std::pmr::polymorphic_allocator<T> {
+public:
+    using std::pmr::polymorphic_allocator<T>::polymorphic_allocator;
+    DefaultInitAllocator() = default;
+    template <typename U>
+    DefaultInitAllocator(const DefaultInitAllocator<U>& other) noexcept
+        : std::pmr::polymorphic_allocator<T>(other.resource()) {}
+
+    template <typename U>
+    void construct(U* p) noexcept(std::is_nothrow_default_constructible<U>::value) {
+        ::new (static_cast<void*>(p)) U;
+    }
+    template <typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        std::pmr::polymorphic_allocator<T>::construct(p, std::forward<Args>(args)...);
+    }
+
+    DefaultInitAllocator select_on_container_copy_construction() const { return DefaultInitAllocator(); }
+};
+
+/**
+ * All frames of one subsystem in one event, stored structure-of-arrays style: every frame's
+ * words back to back in a single buffer, plus an offsets array where frame i spans
+ * [offsets[i], offsets[i + 1]). The whole container is two allocations however many frames it
+ * holds, merging another arena is two bulk appends, and scanning the frames is a linear walk.
+ *
+ * Frames are accessed as FrameViews, by index or by iterating. A view is only valid until the
+ * arena is next appended to, since the word buffer may then move.
+ *
+ * Both arrays allocate from the memory resource given at construction (the event's EventArena
+ * when it has one). Moving an arena keeps its resource; copies use the default heap resource.
+ * Growing the word buffer leaves the new words uninitialised, since they are always copied over.
+ */
+class FrameArena {
+public:
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = FrameView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = FrameView;
+
+        const_iterator(const FrameArena* arena, size_t index) : m_arena(arena), m_index(index) {}
+
+        FrameView operator*() const { return (*m_arena)[m_index]; }
+        FrameView operator[](difference_type n) const { return (*m_arena)[m_index + n]; }
+        const_iterator& operator++() { ++m_index; return *this; }
+        const_iterator operator++(int) { const_iterator old = *this; ++m_index; return old; }
+        const_iterator& operator--() { --m_index; return *this; }
+        const_iterator operator--(int) { const_iterator old = *this; --m_index; return old; }
+        const_iterator& operator+=(difference_type n) { m_index += n; return *this; }
+        const_iterator& operator-=(difference_type n) { m_index -= n; return *this; }
+        const_iterator operator+(difference_type n) const { return const_iterator(m_arena, m_index + n); }
+        const_iterator operator-(difference_type n) const { return const_iterator(m_arena, m_index - n); }
+        difference_type operator-(const const_iterator& other) const {
+            return static_cast<difference_type>(m_index) - static_cast<difference_type>(other.m_index);
+        }
+        bool operator==(const const_iterator& other) const { return m_index == other.m_index; }
+        bool operator!=(const const_iterator& other) const { return m_index != other.m_index; }
+        bool operator<(const const_iterator& other) const { return m_index < other.m_index; }
+
+    private:
+        const FrameArena* m_arena;
+        size_t m_index;
+    };
+
+    /*
+    A run of consecutive frames inside an arena sized with allocate(), filled through append()
+    like the arena itself. Regions of one arena that do not overlap can be filled from different
+    threads at the same time.
+    */
+    class Region {
+    public:
+        void append(const char* bytes, uint32_t num_words) {
+            if (num_words != 0) std::memcpy(m_words + m_used, bytes, num_words * sizeof(uint32_t));
+            m_used += num_words;
+            *m_next_offset++ = m_word_base + m_used;
+        }
+
+    private:
+        friend class FrameArena;
+        Region(uint32_t* words, uint32_t* next_offset, uint32_t word_base)
+            : m_words(words), m_next_offset(next_offset), m_word_base(word_base) {}
+
+        uint32_t* m_words;        // first word of the region
+        uint32_t* m_next_offset;  // end offset of the next frame goes here
+        uint32_t m_word_base;     // index of m_words[0] in the arena
+        uint32_t m_used = 0;
+    };
+
+    explicit FrameArena(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : m_words(resource), m_offsets(1, 0, resource) {}
+
+    // Number of frames
+    size_t size() const { return m_offsets.size() - 1; }
+    bool empty() const { return size() == 0; }
+
+    // Total number of words over all frames
+    size_t word_count() const { return m_words.size(); }
+    const uint32_t* words() const { return m_words.data(); }
+
+    FrameView operator[](size_t i) const {
+        return FrameView{m_words.data() + m_offsets[i], m_offsets[i + 1] - m_offsets[i]};
+    }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, size()); }
+
+    void reserve(size_t frames, size_t words) {
+        m_offsets.reserve(frames + 1);
+        m_words.reserve(words);
+    }
+
+    // Sizes the arena to exactly frames frames and words words, to be filled through region().
+    // The words are left uninitialised: every one of them is written by a region.
+    void allocate(size_t frames, size_t words) {
+        m_words.resize(words);
+        m_offsets.assign(frames + 1, 0);
+    }
+
+    // Region starting at frame first_frame, whose words start at first_word
+    Region region(size_t first_frame, size_t first_word) {
+        return Region(m_words.data() + first_word, m_offsets.data() + first_frame + 1,
+                      static_cast<uint32_t>(first_word));
+    }
+
+    void clear() {
+        m_words.clear();
+        m_offsets.assign(1, 0);
+    }
+
+    // Appends one frame, copying num_words words from bytes (which need not be aligned)
+    void append(const char* bytes, uint32_t num_words) {
+        size_t start = m_words.size();
+        m_words.resize(start + num_words);
+        if (num_words != 0) std::memcpy(m_words.data() + start, bytes, num_words * sizeof(uint32_t));
+        m_offsets.push_back(static_cast<uint32_t>(m_words.size()));
+    }
+
+    void append(const FrameView& frame) {
+        m_words.insert(m_words.end(), frame.words, frame.words + frame.num_words);
+        m_offsets.push_back(static_cast<uint32_t>(m_words.size()));
+    }
+
+    // Appends all frames of other after this arena's frames
+    void append(const FrameArena& other) {
+        uint32_t base = static_cast<uint32_t>(m_words.size());
+        m_words.insert(m_words.end(), other.m_words.begin(), other.m_words.end());
+        m_offsets.reserve(m_offsets.size() + other.size());
+        for (size_t i = 1; i < other.m_offsets.size(); ++i) {
+            m_offsets.push_back(base + other.m_offsets[i]);
+        }
+    }
+
+    void append(FrameArena&& other) {
+        // Assignment keeps this arena's resource: it steals other's buffers when the resources match, else copies
+        if (empty()) {
+            *this = std::move(other);
+            other.clear();
+            return;
+        }
+        append(static_cast<const FrameArena&>(other));
+    }
+
+private:
+    std::vector<uint32_t, DefaultInitAllocator<uint32_t>> m_words; // resize() does not zero-fill
+    std::pmr::vector<uint32_t> m_offsets; // size() + 1 entries, m_offsets[0] == 0
+};
+#endif
@@ -0,0 +1,28 @@
+// FrameView.hh
+#ifndef FRAMEVIEW_H
+#define FRAMEVIEW_H
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Non-owning view of one readout frame: where its 32-bit words start and how many there are.
+ * The words live in the FrameArena of the event's subsystem data, see FrameArena.hh.
+ */
+struct FrameView {
+    const uint32_t* words = nullptr;
+    uint32_t num_words = 0;
+
+    uint32_t operator[](size_t i) const { return words[i]; }
+
+    const uint32_t* begin() const { return words; }
+    const uint32_t* end() const { return words + num_words; }
+    size_t size() const { return num_words; }
+    size_t size_bytes() const { return static_cast<size_t>(num_words) * sizeof(uint32_t); }
+    bool empty() const { return num_words == 0; }
+
+    // Owning copy, for code that needs to keep the words beyond the event's lifetime
+    std::vector<uint32_t> to_vector() const { return std::vector<uint32_t>(begin(), end()); }
+};
+#endif
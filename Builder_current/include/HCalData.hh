@@ -5,10 +5,10 @@
 #include <string>
 #include <vector>
 
-#include "HCalFrame.hh"
+#include "FrameArena.hh"
 // Payload for the HCAL system
 struct HCalData {
     long long timestamp;
-    std::vector<HCalFrame> frames;
+    FrameArena frames; // all frame words contiguous, see FrameArena.hh
 };
 #endif
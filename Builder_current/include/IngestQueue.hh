@@ -0,0 +1,110 @@
+// IngestQueue.hh
+#ifndef INGESTQUEUE_H
+#define INGESTQUEUE_H
+#pragma once
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+ * Bounded lock-free multi-producer / single-consumer queue.
+ *
+ * A ring of cells, each carrying a sequence number next to the stored element (Vyukov's bounded
+ * queue), so there is no per-element node allocation. Producers claim a cell with one CAS on the
+ * tail; the single consumer needs no atomic read-modify-write at all. Head, tail and every cell
+ * sit on their own cache line so listener threads do not false-share with each other or with
+ * the draining thread.
+ *
+ * try_push never blocks: it returns false when the ring is full and leaves the item untouched.
+ * try_pop/drain/empty may only be called from the consumer thread.
+ */
+template <typename T>
+class IngestQueue {
+public:
+    static constexpr size_t kCacheLine = 64;
+
+    explicit IngestQueue(size_t capacity = 1 << 14) {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        m_mask = cap - 1;
+        m_cells.reset(new Cell[cap]);
+        for (size_t i = 0; i < cap; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    IngestQueue(const IngestQueue&) = delete;
+    IngestQueue& operator=(const IngestQueue&) = delete;
+
+    bool try_push(T&& item) {
+        size_t pos = m_tail.value.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_tail.value.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            } else if (diff < 0) {
+                return false; // full: the consumer has not released this cell yet
+            } else {
+                pos = m_tail.value.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& out) {
+        Cell& cell = m_cells[m_head.value & m_mask];
+        size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (seq != m_head.value + 1) return false; // empty, or a producer is still writing it
+        out = std::move(cell.value);
+        cell.value = T();
+        cell.sequence.store(m_head.value + m_mask + 1, std::memory_order_release);
+        ++m_head.value;
+        return true;
+    }
+
+    // Pops up to max_items, handing each to fn. Returns how many were popped.
+    template <typename Fn>
+    size_t drain(Fn&& fn, size_t max_items) {
+        size_t n = 0;
+        T item;
+        while (n < max_items && try_pop(item)) {
+            fn(std::move(item));
+            ++n;
+        }
+        return n;
+    }
+
+    bool empty() const {
+        const Cell& cell = m_cells[m_head.value & m_mask];
+        return cell.sequence.load(std::memory_order_acquire) != m_head.value + 1;
+    }
+
+    size_t capacity() const { return m_mask + 1; }
+
+private:
+    struct alignas(kCacheLine) Cell {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    struct alignas(kCacheLine) PaddedAtomic {
+        std::atomic<size_t> value{0};
+    };
+
+    struct alignas(kCacheLine) PaddedIndex {
+        size_t value = 0;
+    };
+
+    std::unique_ptr<Cell[]> m_cells;
+    size_t m_mask = 0;
+    PaddedAtomic m_tail;   // shared by producers
+    PaddedIndex m_head;    // consumer only
+};
+#endif
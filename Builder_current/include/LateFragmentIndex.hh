@@ -0,0 +1,69 @@
+// LateFragmentIndex.hh
+#ifndef LATEFRAGMENTINDEX_H
+#define LATEFRAGMENTINDEX_H
+#pragma once
+#include <map>
+#include <deque>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Bounded record of recently force-built (timed-out) events, so a straggler that arrives after
+ * its event was sent downstream can be recognised and merged into it instead of opening a new
+ * window of its own.
+ *
+ * Each entry keeps the time range the forced window covered and the event ID it was built as.
+ * Lookups are by timestamp (window matching) or by event ID (event-ID matching). The oldest
+ * entries are evicted first once capacity is reached.
+ */
+class LateFragmentIndex {
+public:
+    using Timestamp = long long;
+
+    explicit LateFragmentIndex(size_t capacity = 1024) : m_capacity(capacity) {}
+
+    void record(Timestamp begin, Timestamp end, uint64_t event_id) {
+        if (m_capacity == 0) return;
+        while (m_order.size() >= m_capacity) evict_oldest();
+        m_by_time[begin] = Window{end, event_id};
+        m_by_id[event_id] = begin;
+        m_order.push_back(begin);
+    }
+
+    // Event ID of the forced window covering ts, if any
+    bool find_by_time(Timestamp ts, uint64_t& event_id) const {
+        auto it = m_by_time.upper_bound(ts);
+        if (it == m_by_time.begin()) return false;
+        --it;
+        if (ts > it->second.end) return false;
+        event_id = it->second.event_id;
+        return true;
+    }
+
+    bool contains_id(uint64_t event_id) const { return m_by_id.count(event_id) != 0; }
+
+    size_t size() const { return m_order.size(); }
+
+private:
+    struct Window {
+        Timestamp end;
+        uint64_t event_id;
+    };
+
+    void evict_oldest() {
+        Timestamp begin = m_order.front();
+        m_order.pop_front();
+        auto it = m_by_time.find(begin);
+        if (it == m_by_time.end()) return;
+        auto id_it = m_by_id.find(it->second.event_id);
+        if (id_it != m_by_id.end() && id_it->second == begin) m_by_id.erase(id_it);
+        m_by_time.erase(it);
+    }
+
+    size_t m_capacity;
+    std::map<Timestamp, Window> m_by_time;          // keyed by window start
+    std::unordered_map<uint64_t, Timestamp> m_by_id;
+    std::deque<Timestamp> m_order;                  // insertion order, for eviction
+};
+#endif
@@ -0,0 +1,305 @@
+// MergerFarm.hh
+#ifndef MERGERFARM_H
+#define MERGERFARM_H
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/prctl.h>
+#endif
+#include "EventMerger.hh"
+#include "EventWriter.hh"
+#include "EventCodec.hh"
+#include "BinaryReader.hh"
+
+/*
+Merger farm: events are merged by N separate processes instead of inside the builder. The builder
+routes every (partial) event by event_id % N over a Unix-domain stream socket to one merger node;
+each node runs its own EventMerger and EventWriter, so all parts of an event meet in the same
+process and nodes share nothing.
+
+On the socket every event is one message: a native-order uint32 body length, then the event in the
+event_codec form. A node finishes (flushing what is still waiting, then draining its writer) once
+every builder that connected to it has closed its connection.
+*/
+namespace merger_farm {
+    inline sockaddr_un socket_address(const std::string& path) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Merger socket path too long: " + path);
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return address;
+    }
+
+    // Builder side of the connection to one merger node
+    class MergerLink {
+    public:
+        // The node may still be starting up, so connecting is retried for up to connect_timeout
+        explicit MergerLink(const std::string& socket_path,
+                            std::chrono::milliseconds connect_timeout = std::chrono::milliseconds(5000)) {
+            sockaddr_un address = socket_address(socket_path);
+            auto give_up = std::chrono::steady_clock::now() + connect_timeout;
+            while (true) {
+                m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+                if (m_fd < 0) throw std::runtime_error("Merger link socket creation failed");
+                if (connect(m_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) break;
+                ::close(m_fd);
+                m_fd = -1;
+                if (std::chrono::steady_clock::now() > give_up) {
+                    throw std::runtime_error("Could not connect to merger node at " + socket_path);
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+
+        MergerLink(MergerLink&& other) noexcept : m_fd(other.m_fd) { other.m_fd = -1; }
+        MergerLink& operator=(MergerLink&& other) noexcept {
+            if (this != &other) {
+                close();
+                m_fd = other.m_fd;
+                other.m_fd = -1;
+            }
+            return *this;
+        }
+        MergerLink(const MergerLink&) = delete;
+        MergerLink& operator=(const MergerLink&) = delete;
+
+        ~MergerLink() { close(); }
+
+        // Blocks until all of message is handed to the socket; a slow node holds the builder back
+        void send(const std::vector<char>& message) {
+            size_t sent = 0;
+            while (sent < message.size()) {
+                ssize_t n = ::send(m_fd, message.data() + sent, message.size() - sent, MSG_NOSIGNAL);
+                if (n < 0) {
+                    if (errno == EINTR) continue;
+                    throw std::runtime_error("Merger link send failed: " + std::string(std::strerror(errno)));
+                }
+                sent += static_cast<size_t>(n);
+            }
+        }
+
+        // Tells the node this builder is done
+        void close() {
+            if (m_fd >= 0) ::close(m_fd);
+            m_fd = -1;
+        }
+
+    private:
+        int m_fd = -1;
+    };
+
+    // Frames event as one message into message (which is overwritten)
+    inline void encode_message(const PhysicsEventData& event, std::vector<char>& message) {
+        message.clear();
+        event_codec::put<uint32_t>(message, 0);
+        event_codec::encode(event, message);
+        uint32_t body = static_cast<uint32_t>(message.size() - sizeof(uint32_t));
+        std::memcpy(message.data(), &body, sizeof(body));
+    }
+
+    struct NodeConfig {
+        std::string socket_path;
+        std::string output_file;             // empty: count events without writing
+        size_t output_queue_capacity = 256;
+        MergerConfig merger;
+        SequencerConfig sequencing;          // stride should be the number of nodes
+        long long builder_wait_ms = 30000;   // give up if no builder has connected by then, 0 = wait for ever
+    };
+
+    /*
+    Runs one merger node: listens on config.socket_path, merges every event received and writes
+    what the merger releases. Returns 0 once all builders that connected have disconnected, or 1 if
+    none connected within config.builder_wait_ms or the output could not be written.
+    */
+    inline int run_node(const NodeConfig& config, const CompletenessModel& completeness) {
+        int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd < 0) throw std::runtime_error("Merger node socket creation failed");
+        sockaddr_un address = socket_address(config.socket_path);
+        unlink(config.socket_path.c_str());
+        if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listen_fd, 16) < 0) {
+            ::close(listen_fd);
+            throw std::runtime_error("Merger node could not listen on " + config.socket_path);
+        }
+        std::cout << "[Merger Node] Listening on " << config.socket_path << std::endl;
+
+        MergedEventQueue merged_events(config.output_queue_capacity);
+        EventWriter writer(merged_events, config.output_file, config.sequencing);
+        writer.start();
+        EventMerger merger(completeness, merged_events, config.merger);
+
+        std::vector<pollfd> fds{{listen_fd, POLLIN, 0}};
+        std::vector<char> body;
+        size_t received = 0;
+        bool had_builder = false;
+        bool no_builder = false;
+        auto started = std::chrono::steady_clock::now();
+        auto last_expiry = started;
+        auto close_builder = [&](size_t i) {
+            ::close(fds[i].fd);
+            fds.erase(fds.begin() + i);
+        };
+        while (!had_builder || fds.size() > 1) {
+            if (poll(fds.data(), fds.size(), 100) < 0 && errno != EINTR) break;
+            auto now = std::chrono::steady_clock::now();
+            if (!had_builder && config.builder_wait_ms != 0 &&
+                now - started >= std::chrono::milliseconds(config.builder_wait_ms)) {
+                std::cerr << "[Merger Node] No builder connected to " << config.socket_path << " within "
+                          << config.builder_wait_ms << " ms, giving up" << std::endl;
+                no_builder = true;
+                break;
+            }
+            if (now - last_expiry >= std::chrono::milliseconds(10)) {
+                merger.expire_stale();
+                last_expiry = now;
+            }
+
+            if (fds[0].revents & POLLIN) {
+                int builder_fd = accept(listen_fd, nullptr, nullptr);
+                if (builder_fd >= 0) {
+                    fds.push_back({builder_fd, POLLIN, 0});
+                    had_builder = true;
+                }
+            }
+            for (size_t i = fds.size() - 1; i >= 1; --i) {
+                if (fds[i].revents == 0) continue;
+                // Builders send whole messages, so once the length is here the body follows
+                uint32_t length = 0;
+                if (recv(fds[i].fd, &length, sizeof(length), MSG_WAITALL) != sizeof(length)) {
+                    close_builder(i);
+                    continue;
+                }
+                body.resize(length);
+                if (length != 0 && recv(fds[i].fd, body.data(), length, MSG_WAITALL) != static_cast<ssize_t>(length)) {
+                    std::cerr << "[Merger Node] Builder disconnected mid-message" << std::endl;
+                    close_builder(i);
+                    continue;
+                }
+                try {
+                    BinaryReader reader(body);
+                    PhysicsEventData event;
+                    event_codec::decode(reader, event);
+                    merger.merge_event(std::move(event));
+                    ++received;
+                } catch (const std::exception& e) {
+                    std::cerr << "[Merger Node] Dropping malformed event message: " << e.what() << std::endl;
+                }
+            }
+        }
+
+        ::close(listen_fd);
+        unlink(config.socket_path.c_str());
+        size_t unfinished = merger.flush_incomplete();
+        merged_events.close();
+        writer.join();
+        std::cout << "[Merger Node] " << config.socket_path << ": " << received << " parts received, "
+                  << writer.complete_events() << " complete and " << writer.partial_events()
+                  << " incomplete events (" << unfinished << " flushed at end of run), "
+                  << writer.bytes_written() << " bytes written" << std::endl;
+        if (writer.sequencer()) writer.sequencer()->print_summary();
+        return (no_builder || writer.output_failed()) ? 1 : 0;
+    }
+
+    /*
+    Local farm: node i listens on socket_paths[i] in a child process of this one. Nodes that were
+    not waited for with wait_local_farm are terminated and reaped when the farm is destroyed, so a
+    builder that fails after forking does not leave them behind.
+    */
+    struct LocalFarm {
+        std::vector<std::string> socket_paths;
+        std::vector<pid_t> pids;
+
+        LocalFarm() = default;
+        LocalFarm(LocalFarm&& other) noexcept
+            : socket_paths(std::move(other.socket_paths)), pids(std::move(other.pids)) {
+            other.pids.clear();
+        }
+        LocalFarm& operator=(LocalFarm&& other) noexcept {
+            if (this != &other) {
+                stop();
+                socket_paths = std::move(other.socket_paths);
+                pids = std::move(other.pids);
+                other.pids.clear();
+            }
+            return *this;
+        }
+        LocalFarm(const LocalFarm&) = delete;
+        LocalFarm& operator=(const LocalFarm&) = delete;
+
+        ~LocalFarm() { stop(); }
+
+        // Terminates and reaps the nodes still running; their sockets are removed
+        void stop() {
+            if (pids.empty()) return;
+            for (pid_t pid : pids) kill(pid, SIGTERM);
+            for (pid_t pid : pids) waitpid(pid, nullptr, 0);
+            for (const auto& path : socket_paths) unlink(path.c_str());
+            std::cerr << "[Builder] Stopped " << pids.size() << " merger processes" << std::endl;
+            pids.clear();
+        }
+    };
+
+    /*
+    Forks num_nodes merger nodes. Must be called before the builder starts any threads, since only
+    the forking thread survives in the children. Node i writes to "<output_file>.<i>" and, since it
+    only sees every num_nodes-th event ID, sequences its output with that stride.
+    */
+    inline LocalFarm spawn_local_farm(size_t num_nodes, const NodeConfig& base, const CompletenessModel& completeness) {
+        LocalFarm farm;
+        pid_t builder = getpid();
+        for (size_t i = 0; i < num_nodes; ++i) {
+            NodeConfig node = base;
+            node.socket_path = "/tmp/event_builder_merger." + std::to_string(getpid()) + "." + std::to_string(i) + ".sock";
+            if (!base.output_file.empty()) node.output_file = base.output_file + "." + std::to_string(i);
+            node.sequencing.stride = num_nodes;
+            std::cout.flush();
+            pid_t pid = fork();
+            if (pid < 0) throw std::runtime_error("Could not fork merger node");
+            if (pid == 0) {
+#ifdef __linux__
+                // Should the builder die without cleaning up, take this node down with it
+                prctl(PR_SET_PDEATHSIG, SIGTERM);
+                if (getppid() != builder) _exit(1); // it already has
+#endif
+                int rc = 1;
+                try {
+                    rc = run_node(node, completeness);
+                } catch (const std::exception& e) {
+                    std::cerr << "[Merger Node] " << e.what() << std::endl;
+                }
+                std::cout.flush();
+                _exit(rc);
+            }
+            farm.socket_paths.push_back(node.socket_path);
+            farm.pids.push_back(pid);
+        }
+        return farm;
+    }
+
+    // Waits for the nodes to finish; returns how many failed
+    inline size_t wait_local_farm(LocalFarm& farm) {
+        size_t failed = 0;
+        for (pid_t pid : farm.pids) {
+            int status = 0;
+            if (waitpid(pid, &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) ++failed;
+        }
+        farm.pids.clear();
+        return failed;
+    }
+}
+#endif
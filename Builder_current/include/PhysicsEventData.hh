@@ -1,18 +1,60 @@
 #ifndef PHYSICSEVENTDATA_H
 #define PHYSICSEVENTDATA_H
 #pragma once
+#include <new>
+#include <memory_resource>
 #include "TrkData.hh"
 #include "HCalData.hh"
 #include "ECalData.hh"
 #include "Fragment.hh"
+#include "EventArena.hh"
 
 // combined payload
 struct PhysicsEventData {
-    long long timestamp;
-    long long event_id;
+    /*
+    Optional per-event arena that the frame arenas and the readout list below allocate from, so
+    the whole event is released at once when it is destroyed. Declared first so it is destroyed
+    last, after the containers living in it. Without one, everything comes from the heap.
+    */
+    EventArenaPool::Lease arena;
+
+    long long timestamp = 0;
+    long long event_id = 0;
     TrkData tracker_info;
     HCalData hcal_info;
     ECalData ecal_info;
-    std::vector<uint64_t> systems_readout;
+    std::pmr::vector<uint64_t> systems_readout;
+
+    PhysicsEventData() : PhysicsEventData(EventArenaPool::Lease()) {}
+
+    explicit PhysicsEventData(EventArenaPool::Lease lease)
+        : arena(std::move(lease)),
+          tracker_info{0, FrameArena(memory())},
+          hcal_info{0, FrameArena(memory())},
+          ecal_info{0, FrameArena(memory())},
+          systems_readout(memory()) {}
+
+    PhysicsEventData(PhysicsEventData&&) = default;
+
+    /*
+    pmr containers keep their own memory resource on assignment, so a member-wise move would copy
+    other's data into this event's arena and then drop the arena it lives in. Rebuilding in place
+    takes other's arena along with its data instead.
+    */
+    PhysicsEventData& operator=(PhysicsEventData&& other) noexcept {
+        if (this != &other) {
+            this->~PhysicsEventData();
+            new (this) PhysicsEventData(std::move(other));
+        }
+        return *this;
+    }
+
+    // A copy could not share the arena, and silently deep-copying whole events is never wanted
+    PhysicsEventData(const PhysicsEventData&) = delete;
+    PhysicsEventData& operator=(const PhysicsEventData&) = delete;
+
+    std::pmr::memory_resource* memory() const {
+        return arena ? arena->resource() : std::pmr::get_default_resource();
+    }
 };
 #endif
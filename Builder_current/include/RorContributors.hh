@@ -0,0 +1,71 @@
+// RorContributors.hh
+#ifndef RORCONTRIBUTORS_H
+#define RORCONTRIBUTORS_H
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+
+/*
+Descriptors of the ROR frame contributors the Decoder and Router handle. The contributor ID is
+bits 23:16 of the frame's subsystem word. A descriptor gives:
+  id            contributor ID
+  name          for logs
+  layout        how the payload after the ROR header is laid out
+  sample_bytes  bytes per payload sample
+
+Decoders are instantiated per descriptor, so each contributor gets a decode loop specialised for
+its fixed layout, and are looked up through a 256-entry table indexed by contributor ID.
+Supporting a new contributor means adding a descriptor here and listing it in
+DecodedContributors; IDs without a descriptor are skipped.
+*/
+enum class PayloadLayout {
+    AdcPairs16  // every 32-bit sample is adc_tm1 then adc, 16 bits each, in native byte order
+};
+
+struct HCalRorContributor {
+    static constexpr uint8_t id = 20;
+    static constexpr const char* name = "HCal";
+    static constexpr PayloadLayout layout = PayloadLayout::AdcPairs16;
+    static constexpr size_t sample_bytes = 4;
+};
+
+struct ECalRorContributor {
+    static constexpr uint8_t id = 30;
+    static constexpr const char* name = "ECal";
+    static constexpr PayloadLayout layout = PayloadLayout::AdcPairs16;
+    static constexpr size_t sample_bytes = 4;
+};
+
+// Names a descriptor type inside generic lambdas: decltype(tag)::type
+template <typename Contributor>
+struct ContributorTag {
+    using type = Contributor;
+};
+
+template <typename... Contributors>
+struct ContributorList {
+    static constexpr size_t kTableSize = 256;
+
+    /*
+    Table indexed by contributor ID: entry id is make(ContributorTag<C>{}) for the descriptor C with
+    that ID, and a value-initialised Fn (a null pointer) everywhere else.
+    */
+    template <typename Fn, typename Make>
+    static constexpr std::array<Fn, kTableSize> table(Make make) {
+        std::array<Fn, kTableSize> entries{};
+        ((entries[Contributors::id] = make(ContributorTag<Contributors>{})), ...);
+        return entries;
+    }
+
+    static constexpr bool unique_ids() {
+        std::array<bool, kTableSize> seen{};
+        bool unique = true;
+        ((unique = unique && !seen[Contributors::id], seen[Contributors::id] = true), ...);
+        return unique;
+    }
+};
+
+using DecodedContributors = ContributorList<HCalRorContributor, ECalRorContributor>;
+static_assert(DecodedContributors::unique_ids(), "two contributor descriptors share an ID");
+#endif
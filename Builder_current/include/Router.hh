@@ -2,16 +2,16 @@
 #include <fstream>
 #include <vector>
 #include <cstdint>
-
-#define SWAP32(x) __builtin_bswap32(x)
-#define SWAP64(x) __builtin_bswap64(x)
+#include <array>
+#include "ByteOrder.hh"
+#include "RorContributors.hh"
 
 // This represents the "Work Order" passed downstream
 struct LdmxPacket {
     uint64_t pulseId;
     uint32_t eventId;
     int subsystemId;
-    std::vector<char> rawPayload; // The encoded ADC data
+    std::vector<uint32_t> payload; // The encoded ADC data, converted to native-order words
 };
 
 class Router {
@@ -31,15 +31,14 @@ public:
             }
 
             // 1. Extract ROR Metadata (Shallow Decode)
-            binFile.seekg(8, std::ios::cur); // Skip Rogue internal headers
-
-            uint32_t rawID; binFile.read((char*)&rawID, 4);
-            uint64_t rawTs; binFile.read((char*)&rawTs, 8);
-            uint32_t rawEv; binFile.read((char*)&rawEv, 4);
+            // Two Rogue internal header words, then ID, PulseID (2 words) and event ID, all big-endian
+            uint32_t header[6];
+            if (!binFile.read(reinterpret_cast<char*>(header), sizeof(header))) break;
+            byte_order::words_from_big_endian(header, 6);
 
-            uint32_t subId = (SWAP32(rawID) >> 16) & 0xFF;
-            uint64_t pulseId = SWAP64(rawTs);
-            uint32_t eventId = SWAP32(rawEv);
+            uint32_t subId = (header[2] >> 16) & 0xFF;
+            uint64_t pulseId = (static_cast<uint64_t>(header[3]) << 32) | header[4];
+            uint32_t eventId = header[5];
 
             // 2. Identify and Capture Payload
             // frameSize includes the 4 bytes of the size word itself.
@@ -48,17 +47,10 @@ public:
 
             int payloadSize = frameSize - 24; // Payload size excluding ROR headers
 
-            if (subId == 20 || subId == 30) {
-                LdmxPacket packet;
-                packet.pulseId = pulseId;
-                packet.eventId = eventId;
-                packet.subsystemId = subId;
-
-                packet.rawPayload.resize(payloadSize);
-                binFile.read(packet.rawPayload.data(), payloadSize);
-
-                // 3. PASS TO DAQ PIPELINE
-                dispatchToBuilder(packet);
+            // Contributors registered in RorContributors.hh are captured, the rest skipped
+            PacketCapture capture = packetCaptures()[subId];
+            if (capture != nullptr) {
+                (this->*capture)(binFile, pulseId, eventId, payloadSize);
             } else {
                 // Skip non-calorimeter frames
                 binFile.seekg(payloadSize, std::ios::cur);
@@ -67,10 +59,37 @@ public:
     }
 
 private:
-    void dispatchToBuilder(const LdmxPacket& pkt) {
-        std::cout << "[Dispatcher] Routing " << (pkt.subsystemId == 20 ? "HCal" : "ECal")
+    using PacketCapture = void (Router::*)(std::ifstream&, uint64_t, uint32_t, int);
+
+    // Contributor ID -> capturePacket specialised for that contributor, or null for frames to skip
+    static const std::array<PacketCapture, DecodedContributors::kTableSize>& packetCaptures() {
+        static constexpr auto table = DecodedContributors::table<PacketCapture>(
+            [](auto tag) { return &Router::capturePacket<typename decltype(tag)::type>; });
+        return table;
+    }
+
+    template <typename Contributor>
+    void capturePacket(std::ifstream& binFile, uint64_t pulseId, uint32_t eventId, int payloadSize) {
+        LdmxPacket packet;
+        packet.pulseId = pulseId;
+        packet.eventId = eventId;
+        packet.subsystemId = Contributor::id;
+
+        // Read the payload straight into the word array and convert it there
+        size_t numWords = payloadSize / 4;
+        packet.payload.resize(numWords);
+        binFile.read(reinterpret_cast<char*>(packet.payload.data()), numWords * 4);
+        byte_order::words_from_big_endian(packet.payload.data(), numWords);
+        binFile.seekg(payloadSize - numWords * 4, std::ios::cur); // a partial trailing word, if any
+
+        // 3. PASS TO DAQ PIPELINE
+        dispatchToBuilder(packet, Contributor::name);
+    }
+
+    void dispatchToBuilder(const LdmxPacket& pkt, const char* subsystemName) {
+        std::cout << "[Dispatcher] Routing " << subsystemName
                   << " Packet | PulseID: " << pkt.pulseId
-                  << " | Payload Size: " << pkt.rawPayload.size() << " bytes" << std::endl;
+                  << " | Payload Size: " << pkt.payload.size() * 4 << " bytes" << std::endl;
 
         // This is where your EventBuilder logic would take over to
         // match this PulseID with other subsystems.
@@ -0,0 +1,125 @@
+// SpillStore.hh
+#ifndef SPILLSTORE_H
+#define SPILLSTORE_H
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Location of a spilled payload inside the spill file
+struct SpillRef {
+    uint64_t offset;
+    uint64_t size;
+};
+
+/**
+ * Append-only local file that fragment payloads are spilled to when the FragmentBuffer is over
+ * its soft memory limit. Writes are strictly sequential; reloads are positional reads. Once
+ * every spilled payload has been reloaded the file is truncated back to zero, so it only grows
+ * while there is a real backlog.
+ *
+ * I/O errors are not thrown: the caller holds the buffer lock and a full disk should not take
+ * the process down. A failed write or read returns false and marks the store failed; it then
+ * takes no more appends, but payloads already in the file can still be reloaded or released.
+ */
+class SpillStore {
+public:
+    SpillStore() = default;
+    SpillStore(const SpillStore&) = delete;
+    SpillStore& operator=(const SpillStore&) = delete;
+    ~SpillStore() { close_file(); }
+
+    void open(const std::string& path) {
+        close_file();
+        m_fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (m_fd < 0) {
+            throw std::runtime_error("Could not open spill file: " + path);
+        }
+        m_path = path;
+        m_end = 0;
+        m_live = 0;
+        m_error.clear();
+    }
+
+    bool is_open() const { return m_fd >= 0; }
+    bool failed() const { return !m_error.empty(); }
+    const std::string& error() const { return m_error; }
+
+    // Writes payload at the end of the file. False if the store has failed or the write fails.
+    bool append(const std::vector<char>& payload, SpillRef& ref) {
+        if (failed()) return false;
+        ref = SpillRef{m_end, payload.size()};
+        size_t written = 0;
+        while (written < payload.size()) {
+            ssize_t n = ::pwrite(m_fd, payload.data() + written, payload.size() - written, static_cast<off_t>(m_end + written));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                // m_end stays put, so a partially written payload is never referenced
+                fail("Write to spill file failed: ", n < 0 ? std::strerror(errno) : "no bytes written");
+                return false;
+            }
+            written += static_cast<size_t>(n);
+        }
+        m_end += payload.size();
+        m_live += payload.size();
+        return true;
+    }
+
+    // Reads a spilled payload back and releases it. False if the read fails; it is released anyway.
+    bool reload(const SpillRef& ref, std::vector<char>& payload) {
+        payload.resize(ref.size);
+        size_t done = 0;
+        while (done < ref.size) {
+            ssize_t n = ::pread(m_fd, payload.data() + done, ref.size - done, static_cast<off_t>(ref.offset + done));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                fail("Read from spill file failed: ", n < 0 ? std::strerror(errno) : "file ends early");
+                std::vector<char>().swap(payload);
+                release(ref);
+                return false;
+            }
+            done += static_cast<size_t>(n);
+        }
+        release(ref);
+        return true;
+    }
+
+    // The payload is no longer needed (reloaded or dropped); reclaims the file once nothing is live
+    void release(const SpillRef& ref) {
+        m_live -= ref.size;
+        if (m_live == 0 && m_end != 0) {
+            if (::ftruncate(m_fd, 0) == 0) {
+                ::lseek(m_fd, 0, SEEK_SET);
+                m_end = 0;
+            }
+        }
+    }
+
+    uint64_t live_bytes() const { return m_live; }
+    uint64_t file_bytes() const { return m_end; }
+
+private:
+    void fail(const char* what, const char* reason) {
+        if (m_error.empty()) m_error = what + m_path + " (" + reason + ")";
+    }
+
+    void close_file() {
+        if (m_fd >= 0) {
+            ::close(m_fd);
+            ::unlink(m_path.c_str());
+            m_fd = -1;
+        }
+    }
+
+    int m_fd = -1;
+    std::string m_path;
+    uint64_t m_end = 0;    // next append offset
+    uint64_t m_live = 0;   // spilled bytes not yet reloaded or released
+    std::string m_error;   // first I/O failure; empty while the store is healthy
+};
+#endif
@@ -0,0 +1,172 @@
+// TaskPool.hh
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+#pragma once
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <exception>
+#include <condition_variable>
+#include <cstddef>
+
+/*
+Tasks submitted together and waited on together. wait() rethrows the first exception any of the
+group's tasks threw, once all of them have finished.
+*/
+class TaskGroup {
+public:
+    TaskGroup() = default;
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+private:
+    friend class TaskPool;
+    std::atomic<size_t> m_pending{0};
+    std::mutex m_error_mutex;
+    std::exception_ptr m_error;
+};
+
+/**
+ * Small work-stealing thread pool. Each worker owns a deque: it pushes and pops its own tasks at
+ * the back (newest first, which keeps nested work cache-warm) and, when that runs dry, steals the
+ * oldest task from the front of another worker's deque. Tasks submitted from outside the pool are
+ * dealt round-robin over the deques.
+ *
+ * A thread waiting on a group runs queued tasks while it waits instead of blocking, so tasks may
+ * themselves submit and wait on nested groups without deadlocking the pool. With zero threads
+ * every task simply runs inside wait() on the caller.
+ */
+class TaskPool {
+public:
+    explicit TaskPool(size_t threads) : m_queues(threads == 0 ? 1 : threads) {
+        for (auto& queue : m_queues) queue = std::make_unique<Queue>();
+        for (size_t i = 0; i < threads; ++i) {
+            m_threads.emplace_back([this, i] { worker_loop(i); });
+        }
+    }
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    ~TaskPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_sleep_mutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+        for (auto& thread : m_threads) thread.join();
+    }
+
+    size_t size() const { return m_threads.size(); }
+
+    template <typename Fn>
+    void submit(TaskGroup& group, Fn&& fn) {
+        group.m_pending.fetch_add(1, std::memory_order_relaxed);
+        Task task{std::function<void()>(std::forward<Fn>(fn)), &group};
+
+        size_t index = t_worker_pool == this ? t_worker_index
+                                             : m_next_queue.fetch_add(1, std::memory_order_relaxed) % m_queues.size();
+        {
+            std::lock_guard<std::mutex> lock(m_queues[index]->mutex);
+            m_queues[index]->tasks.push_back(std::move(task));
+        }
+        m_queued.fetch_add(1, std::memory_order_release);
+        if (!m_threads.empty()) {
+            // Taking the lock orders this with a worker that is about to sleep, so the wake-up is not lost
+            std::lock_guard<std::mutex> lock(m_sleep_mutex);
+            m_wake.notify_one();
+        }
+    }
+
+    // Returns once every task of the group has run, helping with queued work meanwhile
+    void wait(TaskGroup& group) {
+        size_t home = t_worker_pool == this ? t_worker_index : 0;
+        while (group.m_pending.load(std::memory_order_acquire) != 0) {
+            if (!run_one(home)) std::this_thread::yield();
+        }
+        if (group.m_error) {
+            std::exception_ptr error = group.m_error;
+            group.m_error = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    struct Task {
+        std::function<void()> fn;
+        TaskGroup* group;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // Pops from the back of the home queue, else steals from the front of the others
+    bool take(size_t home, Task& task) {
+        {
+            Queue& own = *m_queues[home];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.back());
+                own.tasks.pop_back();
+                return true;
+            }
+        }
+        for (size_t k = 1; k < m_queues.size(); ++k) {
+            Queue& victim = *m_queues[(home + k) % m_queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.front());
+                victim.tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool run_one(size_t home) {
+        if (m_queued.load(std::memory_order_acquire) == 0) return false;
+        Task task;
+        if (!take(home, task)) return false;
+        m_queued.fetch_sub(1, std::memory_order_relaxed);
+        try {
+            task.fn();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(task.group->m_error_mutex);
+            if (!task.group->m_error) task.group->m_error = std::current_exception();
+        }
+        task.group->m_pending.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    void worker_loop(size_t index) {
+        t_worker_pool = this;
+        t_worker_index = index;
+        while (true) {
+            if (run_one(index)) continue;
+            std::unique_lock<std::mutex> lock(m_sleep_mutex);
+            m_wake.wait(lock, [this] { return m_stop || m_queued.load(std::memory_order_acquire) != 0; });
+            if (m_stop) return;
+        }
+    }
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<size_t> m_queued{0};       // tasks sitting in any queue
+    std::atomic<size_t> m_next_queue{0};   // round-robin cursor for external submits
+    std::mutex m_sleep_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+
+    static thread_local TaskPool* t_worker_pool;
+    static thread_local size_t t_worker_index;
+};
+
+inline thread_local TaskPool* TaskPool::t_worker_pool = nullptr;
+inline thread_local size_t TaskPool::t_worker_index = 0;
+#endif
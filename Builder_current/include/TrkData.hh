@@ -2,10 +2,10 @@
 #pragma once
 #include <string>
 #include <vector>
-#include "TrkFrame.hh"
+#include "FrameArena.hh"
 
 // Payload for the tracker system
 struct TrkData {
     long long timestamp;
-    std::vector<TrkFrame> frames;
+    FrameArena frames; // all frame words contiguous, see FrameArena.hh
 };
@@ -0,0 +1,200 @@
+// WindowTuner.hh
+#ifndef WINDOWTUNER_H
+#define WINDOWTUNER_H
+#pragma once
+#include <map>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Streaming quantile estimate using the P-square algorithm (Jain & Chlamtac, 1985):
+ * five markers, O(1) memory and O(1) work per observation, no samples stored.
+ */
+class StreamingQuantile {
+public:
+    explicit StreamingQuantile(double p = 0.5) : m_p(p) {
+        m_increment = {0.0, p / 2.0, p, (1.0 + p) / 2.0, 1.0};
+    }
+
+    void add(double x) {
+        if (m_count < 5) {
+            m_height[m_count++] = x;
+            if (m_count == 5) {
+                std::sort(m_height.begin(), m_height.end());
+                for (int i = 0; i < 5; ++i) m_pos[i] = i;
+                m_desired = {0.0, 2.0 * m_p, 4.0 * m_p, 2.0 + 2.0 * m_p, 4.0};
+            }
+            return;
+        }
+        ++m_count;
+
+        int k;
+        if (x < m_height[0]) {
+            m_height[0] = x;
+            k = 0;
+        } else if (x >= m_height[4]) {
+            m_height[4] = x;
+            k = 3;
+        } else {
+            k = 0;
+            while (k < 3 && x >= m_height[k + 1]) ++k;
+        }
+        for (int i = k + 1; i < 5; ++i) m_pos[i] += 1.0;
+        for (int i = 0; i < 5; ++i) m_desired[i] += m_increment[i];
+
+        for (int i = 1; i < 4; ++i) {
+            double d = m_desired[i] - m_pos[i];
+            if ((d >= 1.0 && m_pos[i + 1] - m_pos[i] > 1.0) || (d <= -1.0 && m_pos[i - 1] - m_pos[i] < -1.0)) {
+                int step = d > 0 ? 1 : -1;
+                double candidate = parabolic(i, step);
+                if (m_height[i - 1] < candidate && candidate < m_height[i + 1]) {
+                    m_height[i] = candidate;
+                } else {
+                    m_height[i] = linear(i, step);
+                }
+                m_pos[i] += step;
+            }
+        }
+    }
+
+    double value() const {
+        if (m_count == 0) return 0.0;
+        if (m_count < 5) {
+            std::array<double, 5> sorted = m_height;
+            std::sort(sorted.begin(), sorted.begin() + m_count);
+            size_t index = static_cast<size_t>(m_p * (m_count - 1) + 0.5);
+            return sorted[index];
+        }
+        return m_height[2];
+    }
+
+    size_t count() const { return m_count; }
+
+private:
+    double parabolic(int i, int d) const {
+        return m_height[i] + d / (m_pos[i + 1] - m_pos[i - 1]) *
+            ((m_pos[i] - m_pos[i - 1] + d) * (m_height[i + 1] - m_height[i]) / (m_pos[i + 1] - m_pos[i]) +
+             (m_pos[i + 1] - m_pos[i] - d) * (m_height[i] - m_height[i - 1]) / (m_pos[i] - m_pos[i - 1]));
+    }
+
+    double linear(int i, int d) const {
+        return m_height[i] + d * (m_height[i + d] - m_height[i]) / (m_pos[i + d] - m_pos[i]);
+    }
+
+    double m_p;
+    size_t m_count = 0;
+    std::array<double, 5> m_height{};
+    std::array<double, 5> m_pos{};
+    std::array<double, 5> m_desired{};
+    std::array<double, 5> m_increment{};
+};
+
+/*
+Bounds and behaviour of the adaptive coherence window. All times in ns.
+
+quantile: which quantile of the per-subsystem timestamp offset the window must cover.
+margin:   safety factor applied on top. Offsets are only learned from complete events, which by
+          construction fit inside the current window, so the estimate is biased low; the margin
+          keeps the window from ratcheting down onto its own truncation.
+update_every: number of complete events between re-tunes.
+*/
+struct WindowTuningConfig {
+    long long min_window_ns = 1000;
+    long long max_window_ns = 10000000;
+    long long min_latency_ns = 1000000;
+    long long max_latency_ns = 1000000000;
+    double quantile = 0.99;
+    double margin = 1.5;
+    size_t update_every = 256;
+};
+
+struct WindowSettings {
+    long long coherence_window_ns;
+    long long latency_delay_ns;
+};
+
+/**
+ * Learns how far each subsystem's timestamps sit from the event anchor (the earliest fragment of
+ * the event) and how late complete events are relative to wall-clock time, and derives the
+ * tightest coherence window and latency delay that still cover the configured quantile.
+ */
+class WindowTuner {
+public:
+    WindowTuner(const WindowTuningConfig& config, WindowSettings initial)
+        : m_config(config), m_settings(initial), m_lag(config.quantile) {}
+
+    /*
+    Records one complete event: the fragment timestamps by subsystem, the anchor, and how long
+    after the anchor (in wall-clock ns) the event became buildable. Returns true if the settings
+    were re-tuned by this call.
+    */
+    bool observe(const std::vector<std::pair<uint64_t, long long>>& subsystem_timestamps,
+                 long long anchor, long long completion_lag_ns) {
+        for (const auto& entry : subsystem_timestamps) {
+            Jitter& jitter = jitter_for(entry.first);
+            double offset = static_cast<double>(entry.second - anchor);
+            jitter.median.add(offset);
+            jitter.tail.add(offset);
+        }
+        if (completion_lag_ns > 0) m_lag.add(static_cast<double>(completion_lag_ns));
+
+        if (++m_since_update < m_config.update_every) return false;
+        m_since_update = 0;
+        retune();
+        return true;
+    }
+
+    WindowSettings settings() const { return m_settings; }
+
+    void print() const {
+        std::cout << "[WindowTuner] coherence window " << m_settings.coherence_window_ns
+                  << " ns, latency delay " << m_settings.latency_delay_ns << " ns" << std::endl;
+        for (const auto& pair : m_jitter) {
+            std::cout << "[WindowTuner]   subsystem " << pair.first
+                      << ": median offset " << pair.second.median.value()
+                      << " ns, p" << static_cast<int>(m_config.quantile * 100) << " offset "
+                      << pair.second.tail.value() << " ns" << std::endl;
+        }
+    }
+
+private:
+    struct Jitter {
+        StreamingQuantile median{0.5};
+        StreamingQuantile tail;
+    };
+
+    Jitter& jitter_for(uint64_t subsystem) {
+        auto it = m_jitter.find(subsystem);
+        if (it == m_jitter.end()) {
+            Jitter jitter;
+            jitter.tail = StreamingQuantile(m_config.quantile);
+            it = m_jitter.emplace(subsystem, jitter).first;
+        }
+        return it->second;
+    }
+
+    void retune() {
+        double widest = 0.0;
+        for (const auto& pair : m_jitter) {
+            widest = std::max(widest, pair.second.tail.value());
+        }
+        long long window = static_cast<long long>(widest * m_config.margin);
+        m_settings.coherence_window_ns = std::clamp(window, m_config.min_window_ns, m_config.max_window_ns);
+
+        if (m_lag.count() > 0) {
+            long long latency = static_cast<long long>(m_lag.value() * m_config.margin);
+            m_settings.latency_delay_ns = std::clamp(latency, m_config.min_latency_ns, m_config.max_latency_ns);
+        }
+    }
+
+    WindowTuningConfig m_config;
+    WindowSettings m_settings;
+    std::map<uint64_t, Jitter> m_jitter;
+    StreamingQuantile m_lag;
+    size_t m_since_update = 0;
+};
+#endif
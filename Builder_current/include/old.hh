@@ -2,10 +2,7 @@
 #include <fstream>
 #include <vector>
 #include <cstdint>
-
-// Utility for Big-Endian to Little-Endian conversion
-#define SWAP32(x) (((x) >> 24) | (((x) & 0x00FF0000) >> 8) | (((x) & 0x0000FF00) << 8) | ((x) << 24))
-#define SWAP64(x) (((uint64_t)SWAP32((uint32_t)(x)) << 32) | (uint64_t)SWAP32((uint32_t)((x) >> 32)))
+#include "ByteOrder.hh"
 
 class Decoder {
 public:
@@ -31,24 +28,22 @@ public:
                 continue;
             }
 
-            // Word 1 & 2: Rogue Internal Headers (Skip 8 bytes)
-            binFile.seekg(8, std::ios::cur);
+            // Words 1-6 are big-endian; read them in one go and convert them together
+            uint32_t header[6];
+            if (!binFile.read(reinterpret_cast<char*>(header), sizeof(header))) break;
+            byte_order::words_from_big_endian(header, 6);
+
+            // Word 1 & 2: Rogue Internal Headers (unused)
 
             // Word 3: Subsystem ID
-            uint32_t rawID;
-            binFile.read(reinterpret_cast<char*>(&rawID), 4);
-            uint32_t sysID = SWAP32(rawID);
+            uint32_t sysID = header[2];
             int contribID = (sysID >> 16) & 0xFF;
 
             // Word 4 & 5: 64-bit PulseID (Timestamp)
-            uint64_t rawTs;
-            binFile.read(reinterpret_cast<char*>(&rawTs), 8);
-            uint64_t timestamp = SWAP64(rawTs);
+            uint64_t timestamp = (static_cast<uint64_t>(header[3]) << 32) | header[4];
 
             // Word 6: 32-bit Event ID
-            uint32_t rawEv;
-            binFile.read(reinterpret_cast<char*>(&rawEv), 4);
-            uint32_t eventId = SWAP32(rawEv);
+            uint32_t eventId = header[5];
 
             // Route based on Contributor ID (20=HCal, 30=ECal)
             if (contribID == 20 || contribID == 30) {
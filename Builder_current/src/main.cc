@@ -10,14 +10,18 @@
 
 #include "PhysicsEventData.hh"
 #include "EventMerger.hh"
+#include "EventWriter.hh"
 #include "DataAggregator.hh"
 
 #include "FragmentBuffer.hh"
 #include "Fragment.hh"
 #include "BinaryReader.hh"
+#include "TaskPool.hh"
 #include "HCalFrame.hh"
 #include "ECalFrame.hh"
 #include "TrkFrame.hh"
+#include "ExamplePackets.hh"
+#include "EcondUnpacker.hh"
 #include "Decoder.hh"
 
 #include <arpa/inet.h>
@@ -26,8 +30,7 @@
 #include <unistd.h>
 #include <stdexcept>
 #include <atomic>
-
-unsigned int event_id = 0;
+#include <memory>
 
 // Helper to convert uint64_t to string for printing
 std::string subsystem_id_to_string(uint64_t id) {
@@ -39,141 +42,160 @@ std::string subsystem_id_to_string(uint64_t id) {
     }
 }
 
+FrameArena* frames_for(PhysicsEventData& event_data, uint64_t subsystem_id) {
+    switch (subsystem_id) {
+        case 0: return &event_data.tracker_info.frames;
+        case 1: return &event_data.hcal_info.frames;
+        case 2: return &event_data.ecal_info.frames;
+        default: return nullptr;
+    }
+}
+
+// Below this many frame words an event is copied on the calling thread; handing out tasks would cost more
+constexpr size_t kParallelAssemblyWords = 16384;
+
+// Optional helpers for event assembly; either may be null
+struct AssemblyResources {
+    TaskPool* tasks = nullptr;        // copies the fragments of large events, and whole events, in parallel
+    EventArenaPool* arenas = nullptr; // per-event memory, released in one go with the event
+};
+
 // Function to gather and assemble fragments into a complete event payload
-PhysicsEventData assemble_payload(const std::vector<DataFragment>& fragments) {
-    PhysicsEventData event_data;
+PhysicsEventData assemble_payload(const std::vector<DataFragment>& fragments, const AssemblyResources& resources = {}) {
+    PhysicsEventData event_data = resources.arenas ? PhysicsEventData(resources.arenas->acquire()) : PhysicsEventData();
     if (fragments.empty()) {
         return event_data;
     }
 
     // Use the timestamp and event ID from the first fragment as the reference
-    // A robust system would check for consistency across fragments
-    event_data.event_id = event_id;//fragments.front().header.event_id; //FIXME - how is this added now?
+    // In event-ID matching mode the FragmentBuffer has already cross-checked the timestamps
+    event_data.event_id = fragments.front().header.event_id;
     event_data.timestamp = fragments.front().header.timestamp;
-
-    // Flags to track if we have already initialized data for a subsystem
-    bool has_tracker = false;
-    bool has_hcal = false;
-    bool has_ecal = false;
-
-    // Process fragments for each subsystem
-    for (const auto& fragment : fragments) {
-        event_data.systems_readout.push_back(fragment.header.subsystem_id);
-
-        if (fragment.header.subsystem_id == 0) {
-            TrkData current_trk_data = read_tracker_data(fragment.payload);
-            if (!has_tracker) {
-                event_data.tracker_info = current_trk_data;
-                has_tracker = true;
-            } else {
-                // Merge subsequent Trk fragments
-                event_data.tracker_info.frames.insert(
-                    event_data.tracker_info.frames.end(),
-                    std::make_move_iterator(current_trk_data.frames.begin()),
-                    std::make_move_iterator(current_trk_data.frames.end())
-                );
-            }
+    event_data.tracker_info.timestamp = event_data.timestamp;
+    event_data.hcal_info.timestamp = event_data.timestamp;
+    event_data.ecal_info.timestamp = event_data.timestamp;
+    event_data.systems_readout.reserve(fragments.size());
+
+    /*
+    Pass 1: walk the frame headers (not the words) to size every subsystem's arena exactly and to
+    place each fragment's frames after those of the fragments before it. Each subsystem keeps the
+    timestamp of its first fragment.
+    */
+    struct Placement {
+        size_t first_frame;
+        size_t first_word;
+    };
+    // Scratch, but taken from the event's arena too: a few bytes per fragment, freed with the event
+    std::pmr::vector<Placement> placement(fragments.size(), event_data.memory());
+    size_t frames_needed[3] = {0, 0, 0};
+    size_t words_needed[3] = {0, 0, 0};
+    bool has_subsystem[3] = {false, false, false};
+    long long* subsystem_timestamp[3] = {&event_data.tracker_info.timestamp, &event_data.hcal_info.timestamp,
+                                         &event_data.ecal_info.timestamp};
+    for (size_t i = 0; i < fragments.size(); ++i) {
+        uint64_t id = fragments[i].header.subsystem_id;
+        event_data.systems_readout.push_back(id);
+        if (id > 2) continue;
+
+        size_t frames, words;
+        long long timestamp = payload_extent(fragments[i].payload, frames, words);
+        if (!has_subsystem[id]) {
+            *subsystem_timestamp[id] = timestamp;
+            has_subsystem[id] = true;
         }
-        else if (fragment.header.subsystem_id == 1) {
-            HCalData current_hcal_data = read_hcal_data(fragment.payload);
-            if (!has_hcal) {
-                event_data.hcal_info = current_hcal_data;
-                has_hcal = true;
-            } else {
-                // Merge subsequent HCal fragments
-                event_data.hcal_info.frames.insert(
-                    event_data.hcal_info.frames.end(),
-                    std::make_move_iterator(current_hcal_data.frames.begin()),
-                    std::make_move_iterator(current_hcal_data.frames.end())
-                );
-            }
-        } else if (fragment.header.subsystem_id == 2) {
-            ECalData current_ecal_data = read_ecal_data(fragment.payload);
-            if (!has_ecal) {
-                event_data.ecal_info = current_ecal_data;
-                has_ecal = true;
-            } else {
-                // Merge subsequent ECal fragments
-                event_data.ecal_info.frames.insert(
-                    event_data.ecal_info.frames.end(),
-                    std::make_move_iterator(current_ecal_data.frames.begin()),
-                    std::make_move_iterator(current_ecal_data.frames.end())
-                );
-            }
+        placement[i] = Placement{frames_needed[id], words_needed[id]};
+        frames_needed[id] += frames;
+        words_needed[id] += words;
+    }
+    for (uint64_t id = 0; id < 3; ++id) {
+        frames_for(event_data, id)->allocate(frames_needed[id], words_needed[id]);
+    }
+
+    /*
+    Pass 2: copy every fragment into its own region. The regions do not overlap, so the copies
+    can run in any order or all at once and the frames still end up in arrival order.
+    */
+    auto fill = [&](size_t i) {
+        uint64_t id = fragments[i].header.subsystem_id;
+        if (id > 2) return;
+        FrameArena::Region region = frames_for(event_data, id)->region(placement[i].first_frame, placement[i].first_word);
+        read_subsystem_data(fragments[i].payload, region);
+    };
+    size_t total_words = words_needed[0] + words_needed[1] + words_needed[2];
+    if (resources.tasks != nullptr && fragments.size() > 1 && total_words >= kParallelAssemblyWords) {
+        TaskGroup group;
+        for (size_t i = 0; i < fragments.size(); ++i) {
+            resources.tasks->submit(group, [&fill, i] { fill(i); });
         }
+        resources.tasks->wait(group);
+    } else {
+        for (size_t i = 0; i < fragments.size(); ++i) fill(i);
     }
 
     return event_data;
 }
 
-// Serialization helpers for simulation
-std::vector<char> serialize_tracker_data(const TrkData& data) {
-    std::vector<char> buffer;
-    auto write = [&](const auto& val) {
-        const char* p = reinterpret_cast<const char*>(&val);
-        buffer.insert(buffer.end(), p, p + sizeof(val));
+/*
+Assembles batch[0, count) into events, several events at once when given a task pool, and returns
+how many were assembled. An event with a payload that overruns its buffer is logged, counted in
+malformed and left out; the events that remain keep their order at the front of events.
+*/
+size_t assemble_events(const std::vector<std::vector<DataFragment>>& batch, size_t count,
+                       std::vector<PhysicsEventData>& events, const AssemblyResources& resources,
+                       size_t& malformed) {
+    if (events.size() < count) events.resize(count);
+    std::vector<std::string> errors(count);
+    auto assemble_one = [&batch, &events, &errors, &resources](size_t i) {
+        try {
+            events[i] = assemble_payload(batch[i], resources);
+        } catch (const std::out_of_range& e) {
+            errors[i] = e.what();
+        }
     };
-
-    write(data.timestamp);
-
-    // Write number of frames
-    uint32_t num_frames = data.frames.size();
-    write(num_frames);
-
-    // Write each frame's data
-    for (const auto& frame : data.frames) {
-        uint32_t num_frame_words = frame.frame_data.size();
-        write(num_frame_words);
-        for (const auto& word : frame.frame_data) {
-            write(word);
+    if (resources.tasks == nullptr || count < 2) {
+        for (size_t i = 0; i < count; ++i) assemble_one(i);
+    } else {
+        TaskGroup group;
+        for (size_t i = 0; i < count; ++i) {
+            resources.tasks->submit(group, [&assemble_one, i] { assemble_one(i); });
         }
+        resources.tasks->wait(group);
     }
-    return buffer;
-}
-
-
-// Serialization helpers for simulation
-std::vector<char> serialize_hcal_data(const HCalData& data) {
-    std::vector<char> buffer;
-    auto write = [&](const auto& val) {
-        const char* p = reinterpret_cast<const char*>(&val);
-        buffer.insert(buffer.end(), p, p + sizeof(val));
-    };
 
-    write(data.timestamp);
-
-    // Write number of frames
-    uint32_t num_frames = data.frames.size();
-    write(num_frames);
-
-    // Write each frame's data
-    for (const auto& frame : data.frames) {
-        uint32_t num_frame_words = frame.frame_data.size();
-        write(num_frame_words);
-        for (const auto& word : frame.frame_data) {
-            write(word);
+    size_t assembled = 0;
+    for (size_t i = 0; i < count; ++i) {
+        if (!errors[i].empty()) {
+            ++malformed;
+            std::cerr << "[Builder] Dropped event ID " << batch[i].front().header.event_id << ": " << errors[i]
+                      << " (" << malformed << " malformed events so far)" << std::endl;
+            continue;
         }
+        if (assembled != i) events[assembled] = std::move(events[i]);
+        ++assembled;
     }
-    return buffer;
+    return assembled;
 }
 
-
-// Serialization helpers for simulation
-std::vector<char> serialize_ecal_data(const ECalData& data) {
+/*
+Serialization helper for simulation. Events keep their frames as untyped words in a FrameArena,
+so the simulator builds payloads from its own typed frames (TrkFrame, HCalFrame, ECalFrame).
+*/
+template <typename Frame>
+std::vector<char> serialize_frames(long long timestamp, const std::vector<Frame>& frames) {
     std::vector<char> buffer;
     auto write = [&](const auto& val) {
         const char* p = reinterpret_cast<const char*>(&val);
         buffer.insert(buffer.end(), p, p + sizeof(val));
     };
 
-    write(data.timestamp);
+    write(timestamp);
 
     // Write number of frames
-    uint32_t num_frames = data.frames.size();
+    uint32_t num_frames = frames.size();
     write(num_frames);
 
     // Write each frame's data
-    for (const auto& frame : data.frames) {
+    for (const auto& frame : frames) {
         uint32_t num_frame_words = frame.frame_data.size();
         write(num_frame_words);
         for (const auto& word : frame.frame_data) {
@@ -277,9 +299,14 @@ void tcp_server_listener(FragmentBuffer& buffer, int port) {
             DataFragment fragment;
             fragment.header.timestamp = timestamp;
             fragment.header.subsystem_id = id; //FIXME - add more information to the header
+            fragment.header.contributor_id = 0; // link index is not on the wire yet
+            fragment.header.event_id = event_id;
             fragment.trailer = received_trailer;
             fragment.payload = std::move(payload);
-            buffer.add_fragment(std::move(fragment));
+            // Lock-free hand-off; only waits if the ingest queue is full
+            while (!buffer.submit(std::move(fragment))) {
+                std::this_thread::yield();
+            }
             close(new_socket);
         }
     }
@@ -309,17 +336,14 @@ void stream_from_file(const std::string& filename, int port) {
         // Package the data based on subsystem
         std::vector<char> payload;
         if (sub_id == 0) { // Tracker
-            TrkData data; data.timestamp = ts;
-            data.frames.push_back(TrkFrame()); // Add data based on 'val'
-            payload = serialize_tracker_data(data);
+            std::vector<TrkFrame> frames{example_frame<TrkFrame>()}; // Add data based on 'val'
+            payload = serialize_frames(ts, frames);
         } else if (sub_id == 1) { // HCal
-            HCalData data; data.timestamp = ts;
-            data.frames.push_back(HCalFrame());
-            payload = serialize_hcal_data(data);
+            std::vector<HCalFrame> frames{example_frame<HCalFrame>()};
+            payload = serialize_frames(ts, frames);
         } else { // ECal
-            ECalData data; data.timestamp = ts;
-            data.frames.push_back(ECalFrame());
-            payload = serialize_ecal_data(data);
+            std::vector<ECalFrame> frames{example_frame<ECalFrame>()};
+            payload = serialize_frames(ts, frames);
         }
 
         // Send to the Event Builder via TCP
@@ -331,9 +355,433 @@ void stream_from_file(const std::string& filename, int port) {
     server_running = false;
 }
 
+// Prints a short summary of an assembled event before it is handed to the merger
+void report_event(const PhysicsEventData& event, const std::string& banner) {
+    std::cout << banner << std::endl;
+    std::cout << "Event Timestamp: " << event.timestamp << std::endl;
+    std::cout << "Event Subsystems included: ";
+    for (const auto& id : event.systems_readout) {
+        std::cout << subsystem_id_to_string(id) << " ";
+    }
+    std::cout << std::endl;
+
+    size_t tracker_bytes = event.tracker_info.frames.word_count() * sizeof(uint32_t);
+    size_t hcal_bytes = event.hcal_info.frames.word_count() * sizeof(uint32_t);
+    size_t ecal_bytes = event.ecal_info.frames.word_count() * sizeof(uint32_t);
+    size_t total_size = sizeof(PhysicsEventData) + tracker_bytes + hcal_bytes + ecal_bytes;
+    total_size += event.systems_readout.size() * sizeof(uint64_t);
+
+    std::cout << "Estimated event size: " << total_size << " bytes" << std::endl;
+
+    if (!event.tracker_info.frames.empty()) {
+        std::cout << "  - Tracker data:  (" << event.tracker_info.frames.size() << " frames, raw frame size: " << tracker_bytes << " bytes)" << std::endl;
+    }
+    if (!event.hcal_info.frames.empty()) {
+        std::cout << "  - HCal data:    (" << event.hcal_info.frames.size() << " frames, raw frame size: " << hcal_bytes << " bytes)" << std::endl;
+    }
+    if (!event.ecal_info.frames.empty()) {
+        std::cout << "  - ECal data:   (" << event.ecal_info.frames.size() << " frames, raw frame size: " << ecal_bytes << " bytes)" << std::endl;
+    }
+}
+
+// Unpacks the event's HCal and ECal ECON-D packets and prints the hit counts
+void report_hits(const PhysicsEventData& event, EcondUnpacker& unpacker, EcondHits& hits) {
+    auto unpack_all = [&](const FrameArena& frames, const char* name) {
+        if (frames.empty()) return;
+        hits.clear();
+        size_t dropped_links = 0;
+        size_t dropped_packets = 0;
+        for (FrameView frame : frames) {
+            if (unpacker.unpack(frame, hits)) continue;
+            for (const EcondFaultRecord& fault : unpacker.faults()) {
+                if (fault.link == EcondFaultRecord::kWholePacket) ++dropped_packets;
+                else ++dropped_links;
+            }
+        }
+        std::cout << "  - " << name << " hits: " << hits.size() << " from " << frames.size() << " frames";
+        if (dropped_links + dropped_packets != 0) {
+            std::cout << " (dropped " << dropped_links << " bad links, " << dropped_packets << " bad packets)";
+        }
+        std::cout << std::endl;
+    };
+    unpack_all(event.hcal_info.frames, "HCal");
+    unpack_all(event.ecal_info.frames, "ECal");
+}
+
+// Settings for the simulated builder, filled from the command line
+struct BuilderConfig {
+    std::string events_file;
+    std::string completeness_file;        // empty: one fragment from each of Tracker, HCal and ECal
+    MatchMode match_mode = MatchMode::TimeWindow;
+    size_t expected_in_flight = 1 << 16;  // event-ID table pre-size
+    MemoryLimits memory_limits;           // soft/hard byte limits and spill file, 0 = unlimited
+    bool adaptive_window = false;         // learn window/latency from measured jitter
+    WindowTuningConfig window_tuning;
+    bool calibrate_clocks = false;        // align subsystem clocks before matching
+    ClockCalibrationConfig clock_calibration;
+    size_t late_index_capacity = 1024;    // recently force-built events remembered for stragglers, 0 = off
+    size_t assembly_threads = 0;          // task pool for event assembly, 0 = assemble on the builder thread
+    size_t event_arena_bytes = 64 * 1024; // initial per-event arena block, 0 = allocate events on the heap
+    bool unpack_econd = false;            // unpack HCal/ECal packets into hits when reporting events
+    std::string output_file;              // merged event records, empty: count events without writing
+    size_t output_queue_capacity = 256;   // merged events waiting for the writer before the merger blocks
+    MergerConfig merger;                  // shards, table pre-size and timeout of the event merger
+    SequencerConfig sequencing;           // event-ID reordering before the writer, capacity 0 = off
+    size_t merger_farm = 0;               // merger processes forked locally, 0 = merge in this process
+    std::vector<std::string> merger_sockets; // already running merger nodes to send events to
+    long long merger_wait_ms = 30000;     // a merger node gives up if no builder connects by then, 0 = never
+};
+
+// Settings of a merger node, local or standalone, taken from the builder's
+merger_farm::NodeConfig node_config(const BuilderConfig& config) {
+    merger_farm::NodeConfig node;
+    node.output_file = config.output_file;
+    node.output_queue_capacity = config.output_queue_capacity;
+    node.merger = config.merger;
+    node.sequencing = config.sequencing;
+    node.builder_wait_ms = config.merger_wait_ms;
+    return node;
+}
+
+// Prints the buffer's byte accounting; spill/reload rates are per second since the last report
+void report_buffer_metrics(const BufferMetrics& now, const BufferMetrics& last, double seconds) {
+    std::cout << "[Buffer] in memory: " << now.memory_bytes << " bytes, spilled: " << now.spilled_bytes
+              << " bytes, spill rate: " << (now.spilled_total - last.spilled_total) / seconds
+              << " B/s, reload rate: " << (now.reloaded_total - last.reloaded_total) / seconds
+              << " B/s, dropped: " << now.dropped_fragments << " fragments (" << now.dropped_bytes << " bytes)";
+    if (now.spill_failures != 0) std::cout << ", spill failures: " << now.spill_failures;
+    std::cout << std::endl;
+    for (const auto& pair : now.memory_by_subsystem) {
+        std::cout << "[Buffer]   " << subsystem_id_to_string(pair.first) << ": " << pair.second << " bytes in memory";
+        auto spilled = now.spilled_by_subsystem.find(pair.first);
+        if (spilled != now.spilled_by_subsystem.end()) std::cout << ", " << spilled->second << " bytes spilled";
+        std::cout << std::endl;
+    }
+}
+
+// Runs the simulated DAQ chain: file playback -> TCP -> FragmentBuffer -> builder -> merger.
+int run_event_builder(const BuilderConfig& config) {
+    CompletenessModel completeness = config.completeness_file.empty()
+        ? CompletenessModel::default_model()
+        : CompletenessModel::load(config.completeness_file);
+    completeness.print();
+
+    // With a merger farm events are merged in other processes; local nodes are forked before any thread starts
+    merger_farm::LocalFarm farm;
+    std::vector<std::string> merger_sockets = config.merger_sockets;
+    if (config.merger_farm != 0) {
+        farm = merger_farm::spawn_local_farm(config.merger_farm, node_config(config), completeness);
+        merger_sockets = farm.socket_paths;
+    }
+
+    // Starting point; with --adaptive-window the buffer re-tunes both from measured jitter
+    const WindowSettings configured_window{1000000, 200000000};
+    const long long coherence_window_ns = configured_window.coherence_window_ns;
+
+    FragmentBuffer buffer(completeness);
+    if (config.match_mode == MatchMode::EventId) {
+        // Event IDs from the trigger are authoritative; the window only bounds timestamp disagreement
+        buffer.use_event_id_matching(config.expected_in_flight, coherence_window_ns);
+    }
+    buffer.set_memory_limits(config.memory_limits);
+    if (config.adaptive_window) {
+        buffer.enable_window_tuning(config.window_tuning, configured_window);
+    }
+    if (config.calibrate_clocks) {
+        buffer.enable_clock_calibration(config.clock_calibration);
+    }
+    if (config.late_index_capacity != 0) {
+        buffer.enable_late_fragment_index(config.late_index_capacity);
+    }
+    // Events in a batch, and the fragments of large events, are deserialized on this pool
+    std::unique_ptr<TaskPool> assembly_pool;
+    if (config.assembly_threads != 0) {
+        assembly_pool = std::make_unique<TaskPool>(config.assembly_threads);
+        std::cout << "[Builder] Assembling events on " << config.assembly_threads << " threads" << std::endl;
+    }
+    // Recycled per-event arenas; events still held by the merger keep the pool's state alive
+    std::unique_ptr<EventArenaPool> event_arenas;
+    if (config.event_arena_bytes != 0) {
+        event_arenas = std::make_unique<EventArenaPool>(config.event_arena_bytes);
+    }
+    const AssemblyResources assembly{assembly_pool.get(), event_arenas.get()};
+
+    // Finished events leave the merger through a bounded queue drained by the writer thread
+    MergedEventQueue merged_events(config.output_queue_capacity);
+    std::unique_ptr<EventWriter> writer;
+    std::unique_ptr<EventMerger> merger; // The new consolidation stage, unless a farm does the merging
+    std::unique_ptr<DataAggregator> aggregator; // The middle stage connecting buffer to merger
+    if (merger_sockets.empty()) {
+        writer = std::make_unique<EventWriter>(merged_events, config.output_file, config.sequencing);
+        writer->start();
+        merger = std::make_unique<EventMerger>(completeness, merged_events, config.merger);
+        aggregator = std::make_unique<DataAggregator>(*merger);
+    } else {
+        std::vector<merger_farm::MergerLink> links;
+        for (const auto& path : merger_sockets) links.emplace_back(path);
+        aggregator = std::make_unique<DataAggregator>(std::move(links));
+        std::cout << "[Builder] Sending events to " << merger_sockets.size() << " merger processes" << std::endl;
+    }
+
+    const int port = 8080;
+    std::cout << "Starting server listener..." << std::endl;
+    std::thread server_thread(tcp_server_listener, std::ref(buffer), port);
+
+    auto build_loop = [&]() {
+
+        // Reused across iterations so the outer vector and each fragment list keep their capacity
+        std::vector<std::vector<DataFragment>> batch;
+        std::vector<LateFragment> late;
+        std::vector<DataFragment> straggler_fragments; // one straggler at a time, moved in
+        std::vector<PhysicsEventData> assembled;
+        EcondUnpacker unpacker;
+        EcondHits hits;
+        const size_t max_batch = 256;
+        bool backlog = false;
+
+        BufferMetrics last_metrics;
+        size_t last_mismatches = 0;
+        size_t malformed_events = 0;
+        auto last_report = std::chrono::steady_clock::now();
+
+        while(server_running) {
+            // Wake as soon as a fragment lands so complete events leave without waiting out the poll.
+            // If the last pass hit max_batch there is more waiting, so go straight back for it.
+            if (!backlog) {
+                buffer.wait_for_fragment(std::chrono::milliseconds(100));
+            }
+            // This thread owns the buffer: move whatever the listeners queued into it in one go
+            buffer.drain_ingest();
+
+            WindowSettings window = buffer.window_settings(configured_window);
+            long long reference_time = std::chrono::time_point_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now()).time_since_epoch().count() - window.latency_delay_ns;
+
+            // Priority 1: Drain complete events (every required subsystem has delivered)
+            size_t n_complete = buffer.try_build_events(reference_time, window.coherence_window_ns, batch, max_batch, false); // force_assemble = false
+            size_t n_built = assemble_events(batch, n_complete, assembled, assembly, malformed_events);
+            for (size_t i = 0; i < n_built; ++i) {
+                PhysicsEventData& full_event = assembled[i];
+                report_event(full_event, "--- Assembled COMPLETE Event sent to Merger ---");
+                if (config.unpack_econd) report_hits(full_event, unpacker, hits);
+                // Pass the complete event to the aggregator
+                aggregator->aggregate(std::move(full_event));
+                std::cout << "---end initial attempt to build-------" << std::endl;
+            }
+
+            // Priority 2: Timeouts are the exception - only windows the model never completed end up here
+            size_t n_expired = buffer.try_build_events(reference_time, window.coherence_window_ns, batch, max_batch, true); // force_assemble = true
+            n_built = assemble_events(batch, n_expired, assembled, assembly, malformed_events);
+            for (size_t i = 0; i < n_built; ++i) {
+                PhysicsEventData& partial_event = assembled[i];
+                report_event(partial_event, "--- Assembled INCOMPLETE Event (TIMEOUT) sent to Merger ---");
+                if (config.unpack_econd) report_hits(partial_event, unpacker, hits);
+                // Pass the (potentially partial) event to the aggregator
+                aggregator->aggregate(std::move(partial_event));
+                std::cout << "------end search for missing fragements----------" << std::endl;
+            }
+
+            // Stragglers of events that already timed out are merged into them, not built on their own
+            late.clear();
+            buffer.take_late_fragments(late);
+            for (auto& straggler : late) {
+                straggler_fragments.clear();
+                straggler_fragments.push_back(std::move(straggler.fragment));
+                PhysicsEventData part;
+                try {
+                    part = assemble_payload(straggler_fragments, assembly);
+                } catch (const std::out_of_range& e) {
+                    ++malformed_events;
+                    std::cerr << "[Builder] Dropped late fragment of event ID " << straggler.event_id << ": "
+                              << e.what() << " (" << malformed_events << " malformed events so far)" << std::endl;
+                    continue;
+                }
+                part.event_id = straggler.event_id;
+                std::cout << "--- Late " << subsystem_id_to_string(part.systems_readout.front())
+                          << " fragment re-merged into Event ID " << part.event_id << " ---" << std::endl;
+                aggregator->aggregate(std::move(part));
+            }
+
+            // Events whose missing parts never came are sent on incomplete rather than held forever
+            if (merger) merger->expire_stale();
+
+            backlog = (n_complete == max_batch || n_expired == max_batch);
+
+            auto now = std::chrono::steady_clock::now();
+            double elapsed = std::chrono::duration<double>(now - last_report).count();
+            if (elapsed >= 1.0) {
+                BufferMetrics metrics = buffer.metrics();
+                report_buffer_metrics(metrics, last_metrics, elapsed);
+                buffer.print_window_tuning();
+                buffer.print_clock_calibration();
+                if (merger) merger->print_merged_status();
+                size_t mismatches = buffer.timestamp_mismatches();
+                if (mismatches != last_mismatches) {
+                    std::cerr << "[FragmentBuffer] " << (mismatches - last_mismatches)
+                              << " fragments disagreed with their event ID's timestamp by more than the tolerance ("
+                              << mismatches << " in total)" << std::endl;
+                    last_mismatches = mismatches;
+                }
+                last_metrics = metrics;
+                last_report = now;
+            }
+        }
+    };
+    // A failure on the builder thread (e.g. a merger node gone) stops the run and is rethrown on this one
+    std::exception_ptr builder_failure;
+    std::thread builder_thread([&]() {
+        try {
+            build_loop();
+        } catch (...) {
+            builder_failure = std::current_exception();
+            server_running = false;
+        }
+    });
+
+    // Replace the old simulation_thread with this:
+    std::thread file_thread(stream_from_file, config.events_file, port);
+
+    file_thread.join();
+    builder_thread.join();
+    server_thread.join();
+
+    if (builder_failure) {
+        // Let the writer thread finish; unwinding then closes the farm links and stops a local farm
+        merged_events.close();
+        std::rethrow_exception(builder_failure);
+    }
+
+    if (!merger) {
+        // Closing the links lets each node flush, drain its writer and exit
+        aggregator->close();
+        size_t failed = merger_farm::wait_local_farm(farm);
+        if (failed != 0) {
+            std::cerr << "[Builder] " << failed << " merger processes failed" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    // Whatever never completed goes out flagged as incomplete, then the writer drains and stops
+    size_t unfinished = merger->flush_incomplete();
+    merged_events.close();
+    writer->join();
+    std::cout << "[Writer] " << writer->complete_events() << " complete and " << writer->partial_events()
+              << " incomplete events (" << unfinished << " flushed at end of run), " << writer->bytes_written()
+              << " bytes written, output queue peak " << merged_events.high_water() << "/"
+              << merged_events.capacity() << std::endl;
+    if (writer->sequencer()) writer->sequencer()->print_summary();
+
+    return writer->output_failed() ? 1 : 0;
+}
+
 #include "Router.hh"
 int main(int argc, char** argv) {
     if (argc < 2) return 1;
+    // event_builder --build <events.txt> [--completeness <file>] [--match window|event-id]
+    //               [--soft-limit <bytes> --spill-file <path>] [--hard-limit <bytes>]
+    //               [--adaptive-window <min_ns>:<max_ns>] [--calibrate-clocks <reference_subsystem>]
+    //               [--late-index <capacity>] [--assembly-threads <n>] [--event-arena-kb <kb>]
+    //               [--unpack-econd on|off] [--output <file>] [--output-queue <events>]
+    //               [--merger-shards <n>] [--merger-in-flight <events>] [--merger-timeout-ms <ms>]
+    //               [--merger-farm <n> | --merger-sockets <path>,<path>...] [--merger-wait-ms <ms>]
+    //               [--sequence <capacity>] [--sequence-hold-ms <ms>]
+    // event_builder --merge <socket> [--completeness <file>] [--output <file>] [--output-queue <events>]
+    //               [--merger-shards <n>] [--merger-in-flight <events>] [--merger-timeout-ms <ms>]
+    //               [--sequence <capacity>] [--sequence-hold-ms <ms>] [--sequence-stride <nodes>]
+    //               [--merger-wait-ms <ms>]
+    std::string mode = argv[1];
+    if (mode == "--build" || mode == "--merge") {
+        if (argc < 3) return 1;
+        BuilderConfig config;
+        config.events_file = argv[2];
+        for (int i = 3; i + 1 < argc; i += 2) {
+            std::string option = argv[i];
+            std::string value = argv[i + 1];
+            if (option == "--completeness") {
+                config.completeness_file = value;
+            } else if (option == "--soft-limit") {
+                config.memory_limits.soft_limit_bytes = std::stoull(value);
+            } else if (option == "--hard-limit") {
+                config.memory_limits.hard_limit_bytes = std::stoull(value);
+            } else if (option == "--spill-file") {
+                config.memory_limits.spill_path = value;
+            } else if (option == "--adaptive-window") {
+                // <min_ns>:<max_ns> bounds for the tuned coherence window
+                size_t colon = value.find(':');
+                if (colon == std::string::npos) {
+                    std::cerr << "--adaptive-window expects <min_ns>:<max_ns>" << std::endl;
+                    return 1;
+                }
+                config.adaptive_window = true;
+                config.window_tuning.min_window_ns = std::stoll(value.substr(0, colon));
+                config.window_tuning.max_window_ns = std::stoll(value.substr(colon + 1));
+            } else if (option == "--calibrate-clocks") {
+                // subsystem whose clock the others are aligned to
+                config.calibrate_clocks = true;
+                config.clock_calibration.reference_subsystem = std::stoull(value);
+            } else if (option == "--late-index") {
+                config.late_index_capacity = std::stoull(value);
+            } else if (option == "--assembly-threads") {
+                config.assembly_threads = std::stoull(value);
+            } else if (option == "--event-arena-kb") {
+                config.event_arena_bytes = std::stoull(value) * 1024;
+            } else if (option == "--unpack-econd") {
+                config.unpack_econd = (value == "on");
+            } else if (option == "--output") {
+                config.output_file = value;
+            } else if (option == "--output-queue") {
+                config.output_queue_capacity = std::stoull(value);
+            } else if (option == "--merger-shards") {
+                config.merger.shards = std::stoull(value);
+            } else if (option == "--merger-in-flight") {
+                config.merger.expected_in_flight = std::stoull(value);
+            } else if (option == "--merger-timeout-ms") {
+                config.merger.timeout_ns = std::stoll(value) * 1000000;
+            } else if (option == "--sequence") {
+                config.sequencing.capacity = std::stoull(value);
+            } else if (option == "--sequence-hold-ms") {
+                config.sequencing.max_hold_ns = std::stoll(value) * 1000000;
+            } else if (option == "--sequence-stride") {
+                config.sequencing.stride = std::stoull(value);
+            } else if (option == "--merger-wait-ms") {
+                config.merger_wait_ms = std::stoll(value);
+            } else if (option == "--merger-farm") {
+                config.merger_farm = std::stoull(value);
+            } else if (option == "--merger-sockets") {
+                std::stringstream paths(value);
+                std::string path;
+                while (std::getline(paths, path, ',')) {
+                    if (!path.empty()) config.merger_sockets.push_back(path);
+                }
+            } else if (option == "--match") {
+                config.match_mode = (value == "event-id") ? MatchMode::EventId : MatchMode::TimeWindow;
+            } else {
+                std::cerr << "Unknown option: " << option << std::endl;
+                return 1;
+            }
+        }
+        if (config.memory_limits.soft_limit_bytes != 0 && config.memory_limits.spill_path.empty()) {
+            // Without somewhere to spill to the soft limit would do nothing
+            std::cerr << "--soft-limit needs --spill-file" << std::endl;
+            return 1;
+        }
+        try {
+            if (mode == "--merge") {
+                // Standalone merger node for builders started with --merger-sockets
+                merger_farm::NodeConfig node = node_config(config);
+                node.socket_path = argv[2];
+                CompletenessModel completeness = config.completeness_file.empty()
+                    ? CompletenessModel::default_model()
+                    : CompletenessModel::load(config.completeness_file);
+                return merger_farm::run_node(node, completeness);
+            }
+            return run_event_builder(config);
+        } catch (const std::exception& e) {
+            // Builder thread failures arrive here too; unwinding has already stopped and reaped a local merger farm
+            std::cerr << "[" << (mode == "--merge" ? "Merger Node" : "Builder") << "] " << e.what() << std::endl;
+            return 1;
+        }
+    }
     Router router;
     router.routePackets(argv[1]);
     return 0;
@@ -412,104 +860,3 @@ int main(int argc, char* argv[]) {
     outputFile.close();
     return 0;
 }*/
-
-/*int main() {
-    FragmentBuffer buffer;
-    EventMerger merger; // The new consolidation stage
-    DataAggregator aggregator(merger); // The middle stage connecting buffer to merger
-
-    const int port = 8080;
-    std::cout << "Starting server listener..." << std::endl;
-    std::thread server_thread(tcp_server_listener, std::ref(buffer), port);
-
-    std::thread builder_thread([&]() {
-        const long long coherence_window_ns = 1000000;
-        const long long latency_delay_ns = 200000000;
-        // const int min_subsystems_for_event = 3;
-
-        while(server_running) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            std::vector<DataFragment> fragments;
-
-            long long reference_time = std::chrono::time_point_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now()).time_since_epoch().count() - latency_delay_ns;
-
-            // Priority 1: Check for expired fragments (timeouts)
-            if (buffer.has_expired_fragments(reference_time, coherence_window_ns)) {
-                if (buffer.try_build_event(reference_time, coherence_window_ns, fragments, true)) { // force_assemble = true
-                    PhysicsEventData partial_event = assemble_payload(fragments);
-                    // Pass the (potentially partial) event to the aggregator
-                    aggregator.aggregate(std::move(partial_event));
-                    std::cout << "--- Assembled INCOMPLETE Event (TIMEOUT) sent to Merger ---" << std::endl;
-                    std::cout << "Event Timestamp: " << partial_event.timestamp << std::endl;
-                    std::cout << "Event Subsystems included: ";
-                    for (const auto& id : partial_event.systems_readout) {
-                        std::cout << subsystem_id_to_string(id) << " ";
-                    }
-                    std::cout << std::endl;
-                    size_t total_size = sizeof(PhysicsEventData);
-                    total_size += partial_event.hcal_info.frames.size() * sizeof(uint32_t);
-                    total_size += partial_event.ecal_info.frames.size() * sizeof(uint32_t);
-                    total_size += partial_event.tracker_info.frames.size() * sizeof(uint32_t);
-                    total_size += partial_event.systems_readout.size() * sizeof(uint64_t);
-                    std::cout << "Estimated event size: " << total_size << " bytes" << std::endl;
-                    if (partial_event.tracker_info.frames.size() != 0) {
-                        std::cout << "  - Tracker data: (Raw frame size: " << partial_event.tracker_info.frames.size() * sizeof(uint32_t) << " bytes)" << std::endl;
-                    }
-                    if (partial_event.hcal_info.frames.size() != 0) {
-                        std::cout << "  - HCal data:   (Raw frame size: " << partial_event.hcal_info.frames.size() * sizeof(uint32_t) << " bytes)" << std::endl;
-                    }
-                    if (partial_event.ecal_info.frames.size() != 0) {
-                        std::cout << "  - ECal data: (Raw frame size: " << partial_event.ecal_info.frames.size() * sizeof(uint32_t) << " bytes)" << std::endl;
-                    }
-                    std::cout << "------end search for missing fragements----------" << std::endl;
-                }
-            }
-            // Priority 2: Check for complete events within the normal window
-            else if (buffer.try_build_event(reference_time, coherence_window_ns, fragments, false)) { // force_assemble = false
-                PhysicsEventData full_event = assemble_payload(fragments);
-                // Pass the complete event to the aggregator
-                aggregator.aggregate(std::move(full_event));
-                std::cout << "--- Assembled COMPLETE Event sent to Merger ---" << std::endl;
-                //std::cout << "Event ID: " << full_event.event_id << std::endl;
-                std::cout << "Event Timestamp: " << full_event.timestamp << std::endl;
-                std::cout << "Event Subsystems included: ";
-                for (const auto& id : full_event.systems_readout) {
-                    std::cout << subsystem_id_to_string(id) << " ";
-                }
-                std::cout << std::endl;
-
-                size_t total_size = sizeof(PhysicsEventData);
-                total_size += full_event.tracker_info.frames.size() * sizeof(uint32_t);
-                total_size += full_event.hcal_info.frames.size() * sizeof(uint32_t);
-                total_size += full_event.ecal_info.frames.size() * sizeof(uint32_t);
-                total_size += full_event.systems_readout.size() * sizeof(uint64_t);
-
-                std::cout << "Estimated event size: " << total_size << " bytes" << std::endl;
-
-                if (full_event.tracker_info.frames.size() != 0) {
-                    std::cout << "  - Tracker data:  (Raw frame size: " << full_event.tracker_info.frames.size() * sizeof(uint32_t) << " bytes)" << std::endl;
-                }
-                if (full_event.hcal_info.frames.size() != 0) {
-                    std::cout << "  - HCal data:    (Raw frame size: " << full_event.hcal_info.frames.size() * sizeof(uint32_t) << " bytes)" << std::endl;
-                }
-                if (full_event.ecal_info.frames.size() != 0) {
-                    std::cout << "  - ECal data:   (Raw frame size: " << full_event.ecal_info.frames.size() * sizeof(uint32_t) << " bytes)" << std::endl;
-                }
-                std::cout << "---end initial attempt to build-------" << std::endl;
-            }//
-          }
-    });
-
-    // Replace the old simulation_thread with this:
-    std::thread file_thread(stream_from_file, "events.txt", port);
-
-    file_thread.join();
-    builder_thread.join();
-    server_thread.join();
-
-    simulation_thread.join();
-    builder_thread.join();
-    server_thread.join();
-
-    return 0;
-}*/